@@ -0,0 +1,101 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include "ini_parser.h"
+#include "ini_thread_pool.h"
+
+// Продолжение сопрограммы в нужном потоке: получает функцию возобновления
+// и, например, ставит ее в очередь цикла событий
+using ini_resume_executor = std::function<void(std::function<void()> resume)>;
+
+// Ожидание загрузки в сопрограмме:
+//     ini_parser parser = co_await ini_load_awaitable("config.ini", options, post_to_loop);
+// Файл читается и разбирается задачей общего пула потоков, ошибки загрузки
+// выбрасываются из co_await. Без resume_on сопрограмма продолжается в потоке
+// пула - долгую работу после co_await тогда лучше передать своему потоку
+class ini_load_awaiter
+{
+private:
+    // Состояние загрузки в куче: задача пула не зависит от того, где и как
+    // компилятор разместил сам объект ожидания в кадре сопрограммы
+    struct load_state
+    {
+        std::string filename;
+        ini_parser_options options;
+        ini_resume_executor resume_on;
+        std::optional<ini_parser> result;
+        std::exception_ptr error;
+    };
+
+    std::shared_ptr<load_state> state;
+
+public:
+    ini_load_awaiter(const std::string& filename, const ini_parser_options& options, const ini_resume_executor& resume_on)
+        : state(std::make_shared<load_state>(load_state{ filename, options, resume_on, {}, {} }))
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        ini_thread_pool::shared().submit([state = state, handle]
+        {
+            try
+            {
+                state->result.emplace(state->filename, state->options);
+            }
+            catch (...)
+            {
+                state->error = std::current_exception();
+            }
+
+            if (state->resume_on)
+            {
+                state->resume_on([handle] { handle.resume(); });
+            }
+            else
+            {
+                handle.resume();
+            }
+        });
+    }
+
+    ini_parser await_resume()
+    {
+        if (state->error)
+        {
+            std::rethrow_exception(state->error);
+        }
+
+        // Перемещенный объект уничтожается здесь, а не потоком пула вместе с
+        // состоянием: он еще держит память из ресурса парсера
+        ini_parser parser(std::move(*state->result));
+        state->result.reset();
+        return parser;
+    }
+};
+
+inline ini_load_awaiter ini_load_awaitable(const std::string& filename, const ini_parser_options& options,
+    const ini_resume_executor& resume_on = {})
+{
+    return ini_load_awaiter(filename, options, resume_on);
+}
+
+// Без своих параметров загрузки. Параметры по умолчанию создаются здесь, а не
+// аргументом по умолчанию или {} в вызове: временный агрегат ini_parser_options
+// в выражении co_await GCC 12 размещает в кадре сопрограммы неверно, поэтому
+// свои параметры лучше передавать именованным объектом
+inline ini_load_awaiter ini_load_awaitable(const std::string& filename, const ini_resume_executor& resume_on = {})
+{
+    return ini_load_awaiter(filename, ini_parser_options(), resume_on);
+}
@@ -0,0 +1,82 @@
+#include "ini_batch.h"
+#include "ini_thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+// Первый блок арены файла: хватает на небольшой файл, дальше арена растет сама
+static const size_t batch_arena_initial_size = 8 * 1024;
+
+// Задач столько, сколько потоков пула вместе с вызывающим; номер следующего
+// файла - общий счетчик. Арена у каждого файла своя: общая арена задачи без
+// блокировок досталась бы после загрузки нескольким парсерам сразу
+ini_batch ini_batch::load(const std::vector<std::string>& filenames, const ini_parser_options& options)
+{
+    ini_batch batch;
+    batch.files.resize(filenames.size());
+
+    if (filenames.empty())
+    {
+        return batch;
+    }
+
+    ini_thread_pool& pool = ini_thread_pool::shared();
+    size_t slots = std::min(filenames.size(), static_cast<size_t>(pool.size()) + 1);
+    bool use_arenas = options.memory_resource == nullptr;
+
+    if (use_arenas)
+    {
+        batch.arenas.resize(filenames.size());
+    }
+
+    std::atomic<size_t> next{ 0 };
+    std::atomic<size_t> failures{ 0 };
+
+    pool.parallel_for(slots, [&](size_t)
+    {
+        ini_parser_options file_options = options;
+        file_options.progress = nullptr;
+
+        for (size_t i = next.fetch_add(1); i < filenames.size(); i = next.fetch_add(1))
+        {
+            ini_batch_result& result = batch.files[i];
+            result.filename = filenames[i];
+            bool loaded = false;
+
+            try
+            {
+                if (use_arenas)
+                {
+                    batch.arenas[i] = std::make_unique<std::pmr::monotonic_buffer_resource>(batch_arena_initial_size);
+                    file_options.memory_resource = batch.arenas[i].get();
+                }
+
+                result.parser = std::make_unique<ini_parser>(filenames[i], file_options);
+                loaded = true;
+            }
+            catch (const ini_parser_error& error)
+            {
+                result.error = error;
+            }
+            catch (const std::exception& error)
+            {
+                // Нехватка памяти, ошибка файловой системы и прочее - тоже ошибка файла
+                result.error = ini_parser_error(error.what());
+            }
+
+            // Память незагруженного файла не нужна
+            if (!loaded)
+            {
+                if (use_arenas)
+                {
+                    batch.arenas[i].reset();
+                }
+
+                failures.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+
+    batch.failures = failures.load();
+    return batch;
+}
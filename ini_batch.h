@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <cstddef>
+#include "ini_parser.h"
+
+// Результат загрузки одного файла пакета
+struct ini_batch_result
+{
+    std::string filename;
+    std::unique_ptr<ini_parser> parser;    // nullptr, если файл не загружен
+    std::optional<ini_parser_error> error; // Ошибка загрузки (открытие, синтаксис, include, нехватка памяти)
+
+    bool ok() const
+    {
+        return parser != nullptr;
+    }
+};
+
+// Пакетная загрузка множества файлов. Файлы читаются и разбираются задачами
+// общего пула потоков: каждая задача берет следующий еще не взятый файл, пока
+// они не кончатся, поэтому медленные файлы не задерживают остальные. Каждый
+// парсер размещается в собственной арене (без блокировок и освобождения по
+// одному объекту), арены освобождаются вместе с пакетом. Парсер и после
+// загрузки выделяет память в своей арене (списки get_array, ленивые секции,
+// изменения) под своим mutex, поэтому разные результаты можно читать из разных
+// потоков. Любая ошибка файла не прерывает пакет и сохраняется в его результате.
+// Парсеры живут, пока жив пакет; результаты идут в порядке списка файлов
+class ini_batch
+{
+private:
+    // Арены файлов объявлены раньше результатов: парсеры уничтожаются до своей памяти
+    std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>> arenas;
+    std::vector<ini_batch_result> files;
+    size_t failures = 0;
+
+public:
+    // Параметры применяются к каждому файлу. Если memory_resource не задан,
+    // парсеры размещаются в аренах пакета (use_arena не учитывается); заданный
+    // ресурс используется всеми задачами одновременно и должен быть
+    // потокобезопасным (например, synchronized_pool_resource). progress не
+    // вызывается: ход пакета - число загруженных файлов, а не байт одного файла.
+    // Для множества небольших файлов подходит load_mode = ini_load_mode::read
+    static ini_batch load(const std::vector<std::string>& filenames, const ini_parser_options& options = {});
+
+    ini_batch() = default;
+    ini_batch(ini_batch&&) = default;
+
+    // Прежние парсеры уничтожаются раньше прежних арен
+    ini_batch& operator=(ini_batch&& other) noexcept
+    {
+        files.clear();
+        arenas = std::move(other.arenas);
+        files = std::move(other.files);
+        failures = other.failures;
+        return *this;
+    }
+
+    const std::vector<ini_batch_result>& results() const
+    {
+        return files;
+    }
+
+    size_t size() const
+    {
+        return files.size();
+    }
+
+    const ini_batch_result& operator[](size_t index) const
+    {
+        return files[index];
+    }
+
+    // Количество файлов, загрузка которых закончилась ошибкой
+    size_t failed() const
+    {
+        return failures;
+    }
+};
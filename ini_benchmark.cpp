@@ -0,0 +1,1186 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ini_parser.h"
+#include "ini_events.h"
+#include "ini_schema.h"
+#include "ini_bind.h"
+#include "ini_shared_config.h"
+#include "ini_batch.h"
+#include "ini_diff.h"
+
+// Замеры горячих путей парсера: скорость загрузки файлов разной формы (МБ/с),
+// задержка get_value<T> по типам, поиск существующих и отсутствующих ключей,
+// пиковая память. Файлы генерируются во временном каталоге при запуске.
+// Собственные параметры (остальные передаются Google Benchmark):
+//   --ini_size_mb=N     - размер каждого сгенерированного файла (по умолчанию 8)
+//   --ini_dir=путь      - каталог для сгенерированных файлов
+
+// Форма синтетического файла конфигурации
+struct bench_shape
+{
+    const char* name;
+    size_t keys_per_section; // Ключей в секции (кроме четырех типизированных)
+    size_t value_length;     // Длина значения в символах
+    bool cyrillic;           // Значения и комментарии на русском, как в config.ini
+    bool crlf;               // Переводы строк Windows
+};
+
+static const bench_shape bench_shapes[] =
+{
+    { "small_sections", 8, 16, false, false },
+    { "huge_sections", 100000, 16, false, false },
+    { "long_values", 8, 1024, false, false },
+    { "cyrillic", 8, 16, true, false },
+    { "crlf", 8, 16, false, true },
+};
+
+// Каждая секция начинается с ключей всех типов, затем идут ключи keyN
+static const char* const typed_keys =
+    "int_value = 123456\n"
+    "double_value = 3.14159\n"
+    "bool_value = true\n"
+    "text_value = Значение для чтения строкой\n";
+
+static size_t bench_size_mb = 8;
+static std::filesystem::path bench_dir;
+
+// Генерация файла формы shape размером около size байт
+static std::string generate_config(const bench_shape& shape, size_t size)
+{
+    const char* newline = shape.crlf ? "\r\n" : "\n";
+    std::string filler = shape.cyrillic ? "Тестовая строка " : "value_text_";
+    size_t filler_chars = shape.cyrillic ? 16 : filler.size(); // Кириллица занимает по два байта на символ
+    std::string text;
+    text.reserve(size + size / 8);
+
+    for (size_t section = 0; text.size() < size; ++section)
+    {
+        text += "[Section" + std::to_string(section) + "]";
+        text += newline;
+
+        if (shape.cyrillic)
+        {
+            text += "; Пример секции с русскими комментариями";
+            text += newline;
+        }
+
+        for (const char* line = typed_keys; *line != '\0';)
+        {
+            const char* end = std::strchr(line, '\n');
+            text.append(line, end);
+            text += newline;
+            line = end + 1;
+        }
+
+        for (size_t key = 0; key < shape.keys_per_section && text.size() < size; ++key)
+        {
+            text += "key" + std::to_string(key) + " = ";
+
+            for (size_t length = 0; length < shape.value_length; length += filler_chars)
+            {
+                text += filler;
+            }
+
+            text += newline;
+        }
+
+        text += newline;
+    }
+
+    return text;
+}
+
+// Путь к сгенерированному файлу формы; файл создается при первом обращении
+static const std::string& bench_file(const bench_shape& shape)
+{
+    static std::vector<std::pair<const bench_shape*, std::string>> files;
+
+    for (const auto& file : files)
+    {
+        if (file.first == &shape)
+        {
+            return file.second;
+        }
+    }
+
+    std::filesystem::path path = bench_dir / (std::string("bench_") + shape.name + ".ini");
+    std::string text = generate_config(shape, bench_size_mb * 1024 * 1024);
+    std::ofstream(path, std::ios::binary).write(text.data(), static_cast<std::streamsize>(text.size()));
+    files.emplace_back(&shape, path.string());
+    return files.back().second;
+}
+
+// Ресурс памяти, считающий текущий и пиковый объем выделенных байт
+class counting_resource : public std::pmr::memory_resource
+{
+private:
+    std::pmr::memory_resource* upstream;
+    std::atomic<size_t> current{ 0 };
+    std::atomic<size_t> peak{ 0 };
+
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        void* result = upstream->allocate(bytes, alignment);
+        size_t now = current.fetch_add(bytes) + bytes;
+        size_t seen = peak.load();
+
+        while (now > seen && !peak.compare_exchange_weak(seen, now))
+        {
+        }
+
+        return result;
+    }
+
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+    {
+        upstream->deallocate(ptr, bytes, alignment);
+        current.fetch_sub(bytes);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+public:
+    explicit counting_resource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : upstream(upstream)
+    {
+    }
+
+    size_t peak_bytes() const
+    {
+        return peak.load();
+    }
+};
+
+// Способ загрузки в замере разбора
+enum class bench_load
+{
+    stream,
+    mapped,
+    parallel,
+    lazy,
+    snapshot,
+    progress, // Поток с сообщениями о ходе загрузки
+    async     // ini_parser::load_async в пуле потоков
+};
+
+static const char* bench_load_name(bench_load load)
+{
+    switch (load)
+    {
+    case bench_load::stream: return "stream";
+    case bench_load::mapped: return "mapped";
+    case bench_load::parallel: return "parallel";
+    case bench_load::lazy: return "lazy";
+    case bench_load::snapshot: return "snapshot";
+    case bench_load::progress: return "progress";
+    case bench_load::async: return "async";
+    }
+    return "";
+}
+
+// Небольшие файлы для пакетной загрузки; создаются при первом обращении
+static const std::vector<std::string>& batch_files()
+{
+    static std::vector<std::string> files;
+
+    if (files.empty())
+    {
+        std::filesystem::path dir = bench_dir / "batch";
+        std::filesystem::create_directories(dir);
+        std::string text = generate_config(bench_shapes[0], 2 * 1024);
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            std::filesystem::path path = dir / ("service" + std::to_string(i) + ".ini");
+            std::ofstream(path, std::ios::binary).write(text.data(), static_cast<std::streamsize>(text.size()));
+            files.push_back(path.string());
+        }
+    }
+
+    return files;
+}
+
+// Загрузка тысячи файлов по 2 КБ: по одному парсеру с ареной подряд или пакетом,
+// через поток или чтением целиком
+static void BM_batch_load(benchmark::State& state, bool batch, bool read)
+{
+    const std::vector<std::string>& files = batch_files();
+    ini_parser_options options;
+    options.load_mode = read ? ini_load_mode::read : ini_load_mode::stream;
+    options.use_arena = true;
+
+    for (auto _ : state)
+    {
+        if (batch)
+        {
+            ini_batch loaded = ini_batch::load(files, options);
+            benchmark::DoNotOptimize(loaded.failed());
+        }
+        else
+        {
+            std::vector<std::unique_ptr<ini_parser>> loaded;
+            loaded.reserve(files.size());
+
+            for (const std::string& file : files)
+            {
+                loaded.push_back(std::make_unique<ini_parser>(file, options));
+            }
+
+            benchmark::DoNotOptimize(loaded.data());
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * files.size()));
+}
+
+// Первое чтение списков строит их в памяти парсера. Поток читает каждый второй
+// результат пакета начиная с first и возвращает число неверных значений
+static size_t read_batch_arrays(const ini_batch& loaded, size_t first)
+{
+    size_t bad = 0;
+
+    for (size_t i = first; i < loaded.size(); i += 2)
+    {
+        const ini_parser& parser = *loaded[i].parser;
+
+        for (size_t section = 0;; ++section)
+        {
+            std::string prefix = "Section" + std::to_string(section);
+            std::optional<std::span<const int>> ints = parser.try_get_array<int>(prefix + ".int_value");
+
+            if (!ints)
+            {
+                break;
+            }
+
+            std::span<const double> doubles = parser.get_array<double>(prefix + ".double_value");
+            bad += ints->size() != 1 || (*ints)[0] != 123456;
+            bad += doubles.size() != 1 || doubles[0] != 3.14159;
+        }
+    }
+
+    return bad;
+}
+
+// Загрузка пакета и чтение списков соседних результатов из двух потоков
+// сразу: у каждого парсера своя арена, чтение разных парсеров не пересекается
+static void BM_batch_arrays(benchmark::State& state)
+{
+    const std::vector<std::string>& files = batch_files();
+    ini_parser_options options;
+    options.load_mode = ini_load_mode::read;
+
+    for (auto _ : state)
+    {
+        ini_batch loaded = ini_batch::load(files, options);
+
+        if (loaded.failed() != 0)
+        {
+            state.SkipWithError("Пакет загружен с ошибками");
+            break;
+        }
+
+        size_t odd_bad = 0;
+        std::thread odd([&] { odd_bad = read_batch_arrays(loaded, 1); });
+        size_t bad = read_batch_arrays(loaded, 0);
+        odd.join();
+
+        if (bad + odd_bad != 0)
+        {
+            state.SkipWithError("Неверные значения списков при параллельном чтении пакета");
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * files.size()));
+}
+
+// Файл формы small_sections с некорректной строкой в каждой сотой секции и
+// некорректными заголовками (без ']' и с пробелом в имени), после которых идут
+// ключи, в каждой четвертой: параллельный разбор не должен начинать с них часть
+static const std::string& broken_file()
+{
+    static std::string file;
+
+    if (file.empty())
+    {
+        std::string text = generate_config(bench_shapes[0], bench_size_mb * 1024 * 1024);
+        std::string broken;
+        broken.reserve(text.size() + text.size() / 64);
+        size_t sections = 0;
+
+        for (size_t pos = 0; pos < text.size();)
+        {
+            size_t end = text.find('\n', pos);
+            end = end == std::string::npos ? text.size() : end + 1;
+
+            // Некорректный заголовок - перед заголовком секции, в конце предыдущей:
+            // граница части, попавшая в ее ключи, доходит сначала до него
+            if (text[pos] == '[' && sections % 100 != 0 && sections % 4 == 0)
+            {
+                broken += sections % 8 == 0 ? "[unclosed header\n" : "[bad name]\n";
+                broken += "key_after_bad_header = 1\n";
+            }
+
+            broken.append(text, pos, end - pos);
+
+            if (text[pos] == '[' && sections++ % 100 == 0)
+            {
+                broken += "broken line without equals\n";
+            }
+
+            pos = end;
+        }
+
+        std::filesystem::path path = bench_dir / "bench_broken.ini";
+        std::ofstream(path, std::ios::binary).write(broken.data(), static_cast<std::streamsize>(broken.size()));
+        file = path.string();
+    }
+
+    return file;
+}
+
+// Проверка файла с ошибками за один проход (collect_errors), последовательно или параллельно
+static void BM_collect_errors(benchmark::State& state, unsigned threads)
+{
+    const std::string& file = broken_file();
+    ini_parser_options options;
+    options.load_mode = ini_load_mode::mapped;
+    options.parse_threads = threads;
+    options.collect_errors = true;
+    size_t errors = 0;
+
+    // Параллельный разбор должен давать те же ошибки, что и последовательный.
+    // Проверка идет с 16 потоками независимо от числа ядер: так частей и
+    // границ между ними достаточно, чтобы они попали на некорректные заголовки
+    ini_parser_options serial_options = options;
+    ini_parser_options parallel_options = options;
+    serial_options.parse_threads = 1;
+    parallel_options.parse_threads = 16;
+    ini_parser serial(file, serial_options);
+    ini_parser parallel(file, parallel_options);
+
+    if (!std::equal(serial.diagnostics().begin(), serial.diagnostics().end(),
+        parallel.diagnostics().begin(), parallel.diagnostics().end(),
+        [](const ini_diagnostic& a, const ini_diagnostic& b)
+        {
+            return a.line == b.line && std::strcmp(a.message, b.message) == 0;
+        }))
+    {
+        state.SkipWithError("Ошибки параллельного разбора отличаются от последовательного");
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        ini_parser parser(file, options);
+        errors = parser.diagnostics().size();
+        benchmark::DoNotOptimize(errors);
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * std::filesystem::file_size(file)));
+    state.counters["errors"] = static_cast<double>(errors);
+}
+
+// Источник блоками по 64 КБ из текста в памяти (как распаковка или сеть)
+class bench_chunk_reader : public ini_chunk_reader
+{
+private:
+    std::string_view text;
+    size_t position = 0;
+    bool known_size;
+
+public:
+    bench_chunk_reader(std::string_view text, bool known_size)
+        : text(text), known_size(known_size)
+    {
+    }
+
+    size_t read(char* buffer, size_t size) override
+    {
+        size_t count = std::min({ size, text.size() - position, size_t(64 * 1024) });
+        std::memcpy(buffer, text.data() + position, count);
+        position += count;
+        return count;
+    }
+
+    size_t size_hint() const override
+    {
+        return known_size ? text.size() : 0;
+    }
+};
+
+enum class bench_source
+{
+    text,         // ini_parser::from_text
+    chunks,       // from_chunks без размера: разбор по блокам
+    sized_chunks  // from_chunks с известным размером: один буфер
+};
+
+// Разбор текста, уже находящегося в памяти, без временного файла
+static void BM_parse_source(benchmark::State& state, bench_source source)
+{
+    std::string text = generate_config(bench_shapes[0], bench_size_mb * 1024 * 1024);
+
+    for (auto _ : state)
+    {
+        switch (source)
+        {
+        case bench_source::text:
+        {
+            ini_parser parser = ini_parser::from_text(text);
+            benchmark::DoNotOptimize(parser.contains("Section0.key0"));
+            break;
+        }
+        case bench_source::chunks:
+        case bench_source::sized_chunks:
+        {
+            bench_chunk_reader reader(text, source == bench_source::sized_chunks);
+            ini_parser parser = ini_parser::from_chunks(reader);
+            benchmark::DoNotOptimize(parser.contains("Section0.key0"));
+            break;
+        }
+        }
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+// Кириллица А-я текста UTF-8 в CP1251 (другие символы генератор не использует)
+static std::string to_cp1251(std::string_view text)
+{
+    std::string result;
+    result.reserve(text.size());
+
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+
+        if (c < 0x80)
+        {
+            result += static_cast<char>(c);
+            continue;
+        }
+
+        unsigned code = ((c & 0x1Fu) << 6) | (static_cast<unsigned char>(text[++i]) & 0x3Fu);
+        result += static_cast<char>(0xC0 + (code - 0x410));
+    }
+
+    return result;
+}
+
+// Проверка UTF-8 формы shape перед разбором
+static void BM_validate_utf8(benchmark::State& state, const bench_shape* shape)
+{
+    std::string text = generate_config(*shape, bench_size_mb * 1024 * 1024);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ini_find_invalid_utf8(text));
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+// Перекодирование текста формы cyrillic из CP1251 в UTF-8
+static void BM_transcode_cp1251(benchmark::State& state)
+{
+    std::string text = to_cp1251(generate_config(bench_shapes[3], bench_size_mb * 1024 * 1024));
+    std::pmr::vector<char> out;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ini_transcode_to_utf8(text, ini_encoding::cp1251, out));
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+// Загрузка файла целиком: байты в секунду и пиковая память парсера
+// (выделенная через его ресурс, без учета буферов потоков ввода)
+static void BM_parse_file(benchmark::State& state, const bench_shape* shape, bench_load load)
+{
+    const std::string& filename = bench_file(*shape);
+    const size_t file_size = static_cast<size_t>(std::filesystem::file_size(filename));
+    size_t peak = 0;
+
+    ini_parser_options options;
+    options.load_mode = load == bench_load::mapped ? ini_load_mode::mapped : ini_load_mode::stream;
+    options.parse_threads = load == bench_load::parallel ? 0 : 1;
+    options.lazy = load == bench_load::lazy;
+
+    if (load == bench_load::snapshot)
+    {
+        options.snapshot_file = filename + ".snap";
+        ini_parser warmup(filename, options);
+    }
+
+    uint64_t reported = 0;
+
+    if (load == bench_load::progress)
+    {
+        options.progress = [&reported](ini_parse_stage, uint64_t done, uint64_t) { reported = done; };
+    }
+
+    for (auto _ : state)
+    {
+        counting_resource counter;
+        options.memory_resource = &counter;
+
+        if (load == bench_load::async)
+        {
+            std::unique_ptr<ini_parser> parser = ini_parser::load_async(filename, options).get();
+            benchmark::DoNotOptimize(parser.get());
+        }
+        else
+        {
+            ini_parser parser(filename, options);
+            benchmark::DoNotOptimize(&parser);
+        }
+
+        peak = counter.peak_bytes();
+    }
+
+    benchmark::DoNotOptimize(reported);
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file_size));
+    state.counters["peak_memory"] = benchmark::Counter(static_cast<double>(peak), benchmark::Counter::kDefaults, benchmark::Counter::OneK::kIs1024);
+    state.counters["memory_ratio"] = static_cast<double>(peak) / static_cast<double>(file_size);
+}
+
+// Разбор текста из памяти в поток событий без хранилища: предел скорости разбора
+static void BM_parse_events(benchmark::State& state, const bench_shape* shape)
+{
+    std::ifstream file(bench_file(*shape), std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    struct counting_visitor : ini_event_visitor
+    {
+        size_t values = 0;
+
+        void on_key_value(std::string_view, std::string_view, std::string_view, int)
+        {
+            values++;
+        }
+    };
+
+    for (auto _ : state)
+    {
+        counting_visitor visitor;
+        ini_read_events(std::string_view(text), visitor);
+        benchmark::DoNotOptimize(visitor.values);
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+// Сохранение после изменения одного значения той же длины: полная пересборка
+// текста с комментариями или запись только измененных байт
+static void BM_save(benchmark::State& state, ini_save_mode mode)
+{
+    const std::string filename = (bench_dir / "save.ini").string();
+    std::filesystem::copy_file(bench_file(bench_shapes[0]), filename, std::filesystem::copy_options::overwrite_existing);
+    const size_t file_size = static_cast<size_t>(std::filesystem::file_size(filename));
+
+    ini_parser parser(filename, ini_parser_options{ ini_load_mode::mapped });
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        parser.set_value("Section0.int_value", ++i % 2 == 0 ? "654321" : "123456");
+        parser.save(mode);
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file_size));
+}
+
+// Парсер небольшого файла для замеров чтения значений
+static const ini_parser& lookup_parser()
+{
+    static const ini_parser parser(bench_file(bench_shapes[0]), ini_parser_options{});
+    return parser;
+}
+
+// Тот же парсер после freeze: поиск через совершенную хеш-функцию
+static const ini_parser& frozen_parser()
+{
+    static const ini_parser parser = []
+    {
+        ini_parser frozen(lookup_parser());
+        frozen.freeze();
+        return frozen;
+    }();
+    return parser;
+}
+
+// Пути к типизированному ключу в разных секциях, чтобы замер не сводился
+// к чтению одной горячей записи
+static std::vector<std::string> lookup_paths(const char* key, size_t count = 256)
+{
+    std::vector<std::string> paths;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        paths.push_back("Section" + std::to_string(i * 7) + "." + key);
+    }
+
+    return paths;
+}
+
+// Пути к ключу во всех секциях файла в случайном порядке: при большом файле
+// таблицы поиска не помещаются в кеш процессора
+static std::vector<std::string> spread_paths(const char* key)
+{
+    std::vector<std::string> paths;
+
+    for (size_t i = 0; i < lookup_parser().stats().sections; ++i)
+    {
+        paths.push_back("Section" + std::to_string(i) + "." + key);
+    }
+
+    std::shuffle(paths.begin(), paths.end(), std::mt19937(1));
+    return paths;
+}
+
+// get_value<T> по пути "Секция.ключ"
+template<typename T>
+static void BM_get_value(benchmark::State& state, const char* key)
+{
+    const ini_parser& parser = lookup_parser();
+    std::vector<std::string> paths = lookup_paths(key);
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(parser.get_value<T>(paths[i++ % paths.size()]));
+    }
+}
+
+// get_value<T> из конфигурации в общей памяти: поиск по снимку на месте и
+// разбор строки при каждом чтении (без кеша преобразованных значений)
+template<typename T>
+static void BM_shared_get_value(benchmark::State& state, const char* key)
+{
+    const std::string name = "ini_benchmark_" + std::to_string(static_cast<unsigned long long>(
+        std::hash<std::string>()(bench_dir.string())));
+    ini_shared_publisher publisher(name);
+    publisher.publish(lookup_parser());
+
+    ini_shared_config config(name);
+    std::vector<std::string> paths = lookup_paths(key);
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(config.get_value<T>(paths[i++ % paths.size()]));
+    }
+
+    ini_shared_publisher::remove(name);
+}
+
+// Список из 10000 весов: array - чтение из кеша записи, vector - копия
+// кешированного списка, parse - разбор без кеша при каждом чтении
+enum class bench_list { array, vector, parse };
+
+static void BM_list(benchmark::State& state, bench_list mode)
+{
+    std::string weights;
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        weights += (i == 0 ? "" : ", ") + std::to_string(i) + ".25";
+    }
+
+    ini_parser parser = ini_parser::from_text("[model]\nweights = " + weights + "\n");
+
+    for (auto _ : state)
+    {
+        double sum = 0;
+
+        if (mode == bench_list::array)
+        {
+            for (double w : parser.get_array<double>("model.weights"))
+            {
+                sum += w;
+            }
+        }
+        else if (mode == bench_list::vector)
+        {
+            for (double w : parser.get_value<std::vector<double>>("model.weights"))
+            {
+                sum += w;
+            }
+        }
+        else
+        {
+            std::vector<double> values;
+            ini_value_traits<std::vector<double>>::parse(parser.get_value<std::string_view>("model.weights"), values);
+
+            for (double w : values)
+            {
+                sum += w;
+            }
+        }
+
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+// get_value по строковому литералу: путь передается как string_view без копии
+static void BM_get_value_literal(benchmark::State& state)
+{
+    const ini_parser& parser = lookup_parser();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(parser.get_value<int>("Section7.int_value"));
+    }
+}
+
+// Чтение значения, привязанного схемой при загрузке
+static void BM_schema_get(benchmark::State& state)
+{
+    using int_value = ini_key<"Section7.int_value", int>;
+    using text_value = ini_key<"Section7.text_value", std::string>;
+    ini_schema<int_value, text_value> config(lookup_parser());
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(config.get<int_value>());
+    }
+}
+
+// Структура из всех двенадцати ключей секции: целиком через ini_bind
+// и по одному ключу через get_value
+struct bench_section_config
+{
+    int int_value = 0;
+    double double_value = 0;
+    bool bool_value = false;
+    std::string text_value;
+    std::string_view key0, key1, key2, key3, key4, key5, key6, key7;
+};
+
+static constexpr auto bench_section_fields = ini_fields(
+    ini_field("int_value", &bench_section_config::int_value),
+    ini_field("double_value", &bench_section_config::double_value),
+    ini_field("bool_value", &bench_section_config::bool_value),
+    ini_field("text_value", &bench_section_config::text_value),
+    ini_field("key0", &bench_section_config::key0),
+    ini_field("key1", &bench_section_config::key1),
+    ini_field("key2", &bench_section_config::key2),
+    ini_field("key3", &bench_section_config::key3),
+    ini_field("key4", &bench_section_config::key4),
+    ini_field("key5", &bench_section_config::key5),
+    ini_field("key6", &bench_section_config::key6),
+    ini_field("key7", &bench_section_config::key7));
+
+static void BM_bind_section(benchmark::State& state)
+{
+    const ini_parser& parser = lookup_parser();
+    bench_section_config config;
+
+    for (auto _ : state)
+    {
+        ini_bind(parser, "Section7", config, bench_section_fields);
+        benchmark::DoNotOptimize(&config);
+    }
+}
+
+static void BM_bind_get_value(benchmark::State& state)
+{
+    const ini_parser& parser = lookup_parser();
+    bench_section_config config;
+
+    for (auto _ : state)
+    {
+        config.int_value = parser.get_value<int>("Section7.int_value");
+        config.double_value = parser.get_value<double>("Section7.double_value");
+        config.bool_value = parser.get_value<bool>("Section7.bool_value");
+        config.text_value = parser.get_value<std::string>("Section7.text_value");
+        config.key0 = parser.get_value<std::string_view>("Section7.key0");
+        config.key1 = parser.get_value<std::string_view>("Section7.key1");
+        config.key2 = parser.get_value<std::string_view>("Section7.key2");
+        config.key3 = parser.get_value<std::string_view>("Section7.key3");
+        config.key4 = parser.get_value<std::string_view>("Section7.key4");
+        config.key5 = parser.get_value<std::string_view>("Section7.key5");
+        config.key6 = parser.get_value<std::string_view>("Section7.key6");
+        config.key7 = parser.get_value<std::string_view>("Section7.key7");
+        benchmark::DoNotOptimize(&config);
+    }
+}
+
+// Обход всех ключей секции
+static void BM_section_iterate(benchmark::State& state)
+{
+    const ini_parser& parser = lookup_parser();
+
+    for (auto _ : state)
+    {
+        size_t bytes = 0;
+
+        for (ini_parser::section_view::item item : parser.get_section("Section7"))
+        {
+            bytes += item.value.size();
+        }
+
+        benchmark::DoNotOptimize(bytes);
+    }
+}
+
+// Снимок статистики парсера после чтений (сборка с INI_ENABLE_STATS собирает
+// и счетчики ключей, иначе только размеры)
+static void BM_stats(benchmark::State& state)
+{
+    const ini_parser& parser = lookup_parser();
+
+    for (auto _ : state)
+    {
+        ini_stats stats = parser.stats();
+        benchmark::DoNotOptimize(stats.hot_keys.data());
+    }
+
+    state.counters["stats_enabled"] = ini_stats_enabled ? 1 : 0;
+}
+
+// get_value<T> по заранее разрешенному дескриптору
+template<typename T>
+static void BM_get_value_handle(benchmark::State& state, const char* key)
+{
+    const ini_parser& parser = lookup_parser();
+    std::vector<ini_parser::key_handle> handles;
+
+    for (const std::string& path : lookup_paths(key))
+    {
+        handles.push_back(parser.resolve(path));
+    }
+
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(parser.get_value<T>(handles[i++ % handles.size()]));
+    }
+}
+
+// Поиск существующего ключа без исключений (обычный индекс или после freeze)
+static void BM_lookup_hit(benchmark::State& state, bool frozen, bool spread)
+{
+    const ini_parser& parser = frozen ? frozen_parser() : lookup_parser();
+    std::vector<std::string> paths = spread ? spread_paths("int_value") : lookup_paths("int_value");
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(parser.try_get_value<std::string_view>(paths[i++ % paths.size()]));
+    }
+}
+
+// Поиск отсутствующего ключа в существующей секции и отсутствующей секции
+static void BM_lookup_miss(benchmark::State& state, const char* key, size_t section_offset, bool frozen)
+{
+    const ini_parser& parser = frozen ? frozen_parser() : lookup_parser();
+    std::vector<std::string> paths;
+
+    for (size_t i = 0; i < 256; ++i)
+    {
+        paths.push_back("Section" + std::to_string(i * 7 + section_offset) + "." + key);
+    }
+
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(parser.try_get_value<std::string_view>(paths[i++ % paths.size()]));
+    }
+}
+
+// Построение индекса совершенного хеширования по всем ключам файла
+static void BM_freeze(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        ini_parser parser(lookup_parser());
+        state.ResumeTiming();
+
+        parser.freeze();
+        benchmark::DoNotOptimize(&parser);
+    }
+
+    state.counters["keys"] = static_cast<double>(lookup_parser().stats().keys);
+}
+
+// Добавление новых ключей в копию загруженного файла: по одному через
+// set_value (перестроение массивов на каждый ключ) или одним set_values
+static void BM_insert(benchmark::State& state, bool batch)
+{
+    std::vector<std::string> paths = lookup_paths("added_value", static_cast<size_t>(state.range(0)));
+    std::vector<std::pair<std::string_view, std::string_view>> values;
+
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        paths[i] += std::to_string(i);
+        values.emplace_back(paths[i], "1");
+    }
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        ini_parser parser(lookup_parser());
+        state.ResumeTiming();
+
+        if (batch)
+        {
+            parser.set_values(values);
+        }
+        else
+        {
+            for (const auto& [path, value] : values)
+            {
+                parser.set_value(path, value);
+            }
+        }
+
+        benchmark::DoNotOptimize(&parser);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * values.size()));
+}
+
+// Сравнение конфигурации с копией, в которой изменен один ключ:
+// cold - хеши секций вычисляются заново (первое сравнение после загрузки),
+// cached - хеши уже вычислены, walk - сравнение всех ключей без хешей
+enum class bench_compare { cold, cached, walk };
+
+static void BM_compare(benchmark::State& state, bench_compare mode)
+{
+    ini_parser before(lookup_parser());
+    ini_parser after(lookup_parser());
+    after.set_value("Section7.int_value", "-1");
+
+    // Копии освобождаются вне замера
+    std::optional<ini_parser> cold_before;
+    std::optional<ini_parser> cold_after;
+
+    for (auto _ : state)
+    {
+        if (mode == bench_compare::cold)
+        {
+            state.PauseTiming();
+            cold_before.reset();
+            cold_after.reset();
+            cold_before.emplace(before);
+            cold_after.emplace(after);
+            state.ResumeTiming();
+
+            benchmark::DoNotOptimize(ini_compare(*cold_before, *cold_after));
+        }
+        else if (mode == bench_compare::cached)
+        {
+            benchmark::DoNotOptimize(ini_compare(before, after));
+        }
+        else
+        {
+            size_t changed = 0;
+
+            std::vector<ini_parser::section_view> old_sections = before.sections();
+            std::vector<ini_parser::section_view> new_sections = after.sections();
+
+            for (size_t i = 0; i < old_sections.size(); ++i)
+            {
+                const ini_parser::section_view& old_section = old_sections[i];
+                const ini_parser::section_view& new_section = new_sections[i];
+
+                for (auto old_it = old_section.begin(), new_it = new_section.begin(); old_it != old_section.end(); ++old_it, ++new_it)
+                {
+                    changed += (*old_it).value != (*new_it).value;
+                }
+            }
+
+            benchmark::DoNotOptimize(changed);
+        }
+    }
+
+    state.counters["sections"] = static_cast<double>(before.sections().size());
+}
+
+// Проверка наличия необязательного ключа
+static void BM_contains(benchmark::State& state, const char* key)
+{
+    const ini_parser& parser = lookup_parser();
+    std::vector<std::string> paths = lookup_paths(key);
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(parser.contains(paths[i++ % paths.size()]));
+    }
+}
+
+// Промах через get_value: стоимость исключения с диагностикой
+static void BM_lookup_miss_throw(benchmark::State& state)
+{
+    const ini_parser& parser = lookup_parser();
+    std::vector<std::string> paths = lookup_paths("missing_key");
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        try
+        {
+            benchmark::DoNotOptimize(parser.get_value<int>(paths[i++ % paths.size()]));
+        }
+        catch (const ini_parser_error& e)
+        {
+            benchmark::DoNotOptimize(e.what());
+        }
+    }
+}
+
+static void register_benchmarks()
+{
+    const bench_load loads[] = { bench_load::stream, bench_load::mapped, bench_load::parallel, bench_load::lazy, bench_load::snapshot,
+        bench_load::progress, bench_load::async };
+
+    for (const bench_shape& shape : bench_shapes)
+    {
+        for (bench_load load : loads)
+        {
+            std::string name = std::string("parse_file/") + shape.name + "/" + bench_load_name(load);
+            auto* bench = benchmark::RegisterBenchmark(name.c_str(), BM_parse_file, &shape, load)->Unit(benchmark::kMillisecond);
+
+            // Загрузка идет в потоке пула: процессорное время вызывающего потока не показательно
+            if (load == bench_load::async)
+            {
+                bench->UseRealTime();
+            }
+        }
+
+        std::string validate_name = std::string("encoding/validate_utf8/") + shape.name;
+        benchmark::RegisterBenchmark(validate_name.c_str(), BM_validate_utf8, &shape)->Unit(benchmark::kMillisecond);
+
+        std::string name = std::string("parse_events/") + shape.name;
+        benchmark::RegisterBenchmark(name.c_str(), BM_parse_events, &shape)->Unit(benchmark::kMillisecond);
+    }
+
+    benchmark::RegisterBenchmark("batch/serial_stream", BM_batch_load, false, false)->Unit(benchmark::kMillisecond)->UseRealTime();
+    benchmark::RegisterBenchmark("batch/serial_read", BM_batch_load, false, true)->Unit(benchmark::kMillisecond)->UseRealTime();
+    benchmark::RegisterBenchmark("batch/load_stream", BM_batch_load, true, false)->Unit(benchmark::kMillisecond)->UseRealTime();
+    benchmark::RegisterBenchmark("batch/load_read", BM_batch_load, true, true)->Unit(benchmark::kMillisecond)->UseRealTime();
+    benchmark::RegisterBenchmark("batch/load_arrays", BM_batch_arrays)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+    benchmark::RegisterBenchmark("encoding/cp1251_to_utf8", BM_transcode_cp1251)->Unit(benchmark::kMillisecond);
+
+    benchmark::RegisterBenchmark("source/text", BM_parse_source, bench_source::text)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("source/chunks", BM_parse_source, bench_source::chunks)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("source/sized_chunks", BM_parse_source, bench_source::sized_chunks)->Unit(benchmark::kMillisecond);
+
+    benchmark::RegisterBenchmark("collect_errors/serial", BM_collect_errors, 1u)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("collect_errors/parallel", BM_collect_errors, 0u)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+    benchmark::RegisterBenchmark("save/full", BM_save, ini_save_mode::full)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("save/incremental", BM_save, ini_save_mode::incremental)->Unit(benchmark::kMicrosecond);
+
+    benchmark::RegisterBenchmark("get_value/int", BM_get_value<int>, "int_value");
+    benchmark::RegisterBenchmark("get_value/long_long", BM_get_value<long long>, "int_value");
+    benchmark::RegisterBenchmark("get_value/double", BM_get_value<double>, "double_value");
+    benchmark::RegisterBenchmark("get_value/bool", BM_get_value<bool>, "bool_value");
+    benchmark::RegisterBenchmark("get_value/string", BM_get_value<std::string>, "text_value");
+    benchmark::RegisterBenchmark("get_value/string_view", BM_get_value<std::string_view>, "text_value");
+    benchmark::RegisterBenchmark("get_value/literal_path", BM_get_value_literal);
+    benchmark::RegisterBenchmark("get_value/shared_int", BM_shared_get_value<int>, "int_value");
+    benchmark::RegisterBenchmark("get_value/shared_string_view", BM_shared_get_value<std::string_view>, "text_value");
+
+    benchmark::RegisterBenchmark("get_value_handle/int", BM_get_value_handle<int>, "int_value");
+    benchmark::RegisterBenchmark("get_value_handle/double", BM_get_value_handle<double>, "double_value");
+    benchmark::RegisterBenchmark("get_value_handle/bool", BM_get_value_handle<bool>, "bool_value");
+    benchmark::RegisterBenchmark("get_value_handle/string", BM_get_value_handle<std::string>, "text_value");
+
+    benchmark::RegisterBenchmark("list/get_array", BM_list, bench_list::array)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("list/get_vector", BM_list, bench_list::vector)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("list/parse", BM_list, bench_list::parse)->Unit(benchmark::kMicrosecond);
+
+    benchmark::RegisterBenchmark("schema/get", BM_schema_get);
+
+    benchmark::RegisterBenchmark("section/bind", BM_bind_section);
+    benchmark::RegisterBenchmark("section/get_value", BM_bind_get_value);
+    benchmark::RegisterBenchmark("section/iterate", BM_section_iterate);
+
+    benchmark::RegisterBenchmark("stats/snapshot", BM_stats)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("freeze/build", BM_freeze)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("insert/set_value", BM_insert, false)->Arg(16)->Arg(256)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("insert/set_values", BM_insert, true)->Arg(16)->Arg(256)->Unit(benchmark::kMillisecond);
+
+    benchmark::RegisterBenchmark("compare/cold", BM_compare, bench_compare::cold)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("compare/cached", BM_compare, bench_compare::cached)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("compare/walk", BM_compare, bench_compare::walk)->Unit(benchmark::kMicrosecond);
+
+    benchmark::RegisterBenchmark("lookup/hit", BM_lookup_hit, false, false);
+    benchmark::RegisterBenchmark("lookup/hit_spread", BM_lookup_hit, false, true);
+    benchmark::RegisterBenchmark("lookup/miss_key", BM_lookup_miss, "missing_key", 0, false);
+    benchmark::RegisterBenchmark("lookup/miss_section", BM_lookup_miss, "int_value", 1000000, false);
+    benchmark::RegisterBenchmark("lookup/frozen_hit", BM_lookup_hit, true, false);
+    benchmark::RegisterBenchmark("lookup/frozen_hit_spread", BM_lookup_hit, true, true);
+    benchmark::RegisterBenchmark("lookup/frozen_miss_key", BM_lookup_miss, "missing_key", 0, true);
+    benchmark::RegisterBenchmark("lookup/miss_throw", BM_lookup_miss_throw);
+    benchmark::RegisterBenchmark("lookup/contains_hit", BM_contains, "int_value");
+    benchmark::RegisterBenchmark("lookup/contains_miss", BM_contains, "missing_key");
+}
+
+// Разбор собственных параметров; остальные остаются для Google Benchmark
+static void parse_bench_options(int& argc, char** argv)
+{
+    bench_dir = std::filesystem::temp_directory_path();
+    int out = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg = argv[i];
+
+        if (arg.starts_with("--ini_size_mb="))
+        {
+            bench_size_mb = std::max<size_t>(1, std::strtoull(argv[i] + arg.find('=') + 1, nullptr, 10));
+        }
+        else if (arg.starts_with("--ini_dir="))
+        {
+            bench_dir = std::string(arg.substr(arg.find('=') + 1));
+        }
+        else
+        {
+            argv[out++] = argv[i];
+        }
+    }
+
+    argc = out;
+}
+
+int main(int argc, char** argv)
+{
+    parse_bench_options(argc, argv);
+    benchmark::Initialize(&argc, argv);
+
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+
+    register_benchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
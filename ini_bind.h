@@ -0,0 +1,167 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+#include <array>
+#include <utility>
+#include <optional>
+#include "ini_parser.h"
+#include "ini_schema.h"
+
+// Поле структуры, заполняемое из ключа секции: имя ключа, указатель на член
+// и обязательность. Необязательное поле без ключа в секции сохраняет прежнее
+// значение (инициализатор члена служит значением по умолчанию)
+template<typename Struct, typename T>
+struct ini_field
+{
+    std::string_view key;
+    T Struct::* member;
+    bool required;
+
+    constexpr ini_field(std::string_view key, T Struct::* member, bool required = true)
+        : key(key), member(member), required(required)
+    {
+    }
+};
+
+// Сравнение ключей в порядке std::string_view::compare; ключи с разными первыми
+// байтами (при слиянии - почти все) различаются без вызова memcmp
+inline int ini_compare_keys(std::string_view a, std::string_view b)
+{
+    if (!a.empty() && !b.empty() && a[0] != b[0])
+    {
+        return static_cast<unsigned char>(a[0]) < static_cast<unsigned char>(b[0]) ? -1 : 1;
+    }
+
+    return a.compare(b);
+}
+
+// Чтение одного поля по найденному ключу; проблема добавляется в problems
+template<typename Struct, typename T>
+void ini_bind_field(const ini_parser::section_view& section, Struct& out, const ini_field<Struct, T>& field,
+    std::optional<ini_parser::key_handle> handle, std::vector<std::string>& problems)
+{
+    if (!handle)
+    {
+        if (field.required)
+        {
+            problems.push_back("Ключ '" + std::string(field.key) + "' не найден в секции '" + std::string(section.name()) + "'");
+        }
+        return;
+    }
+
+    // Чтение через дескриптор использует кеш преобразованных значений парсера
+    std::optional<T> value = section.try_get<T>(*handle);
+
+    if (!value)
+    {
+        problems.push_back("Не удалось преобразовать '" + std::string(section.get<std::string_view>(*handle)) + "' в " +
+            ini_value_traits<T>::name + " (ключ '" + std::string(section.name()) + "." + std::string(field.key) + "')");
+        return;
+    }
+
+    out.*field.member = std::move(*value);
+}
+
+// Список полей структуры, упорядоченный по ключам при создании, например:
+//     struct server_config { int port = 80; std::string host; };
+//     constexpr auto server_fields = ini_fields(
+//         ini_field("port", &server_config::port, false),
+//         ini_field("host", &server_config::host));
+template<typename Struct, typename... Types>
+class ini_field_list
+{
+public:
+    static constexpr size_t size = sizeof...(Types);
+
+    // Чтение поля с номером I: handle - найденный ключ или std::nullopt
+    using binder = void (*)(const ini_field_list&, const ini_parser::section_view&, Struct&,
+        std::optional<ini_parser::key_handle>, std::vector<std::string>&);
+
+    std::tuple<ini_field<Struct, Types>...> fields;
+    std::array<std::string_view, size> sorted_keys; // Ключи по возрастанию, как записи секции
+    std::array<binder, size> sorted_binders;        // Чтение поля каждого из этих ключей
+
+    constexpr ini_field_list(ini_field<Struct, Types>... items)
+        : fields(items...), sorted_keys{ items.key... }, sorted_binders{}
+    {
+        fill_binders(std::index_sequence_for<Types...>());
+
+        // Полей немного, и порядок строится один раз - сортировка вставками
+        for (size_t i = 1; i < size; ++i)
+        {
+            for (size_t j = i; j > 0 && sorted_keys[j] < sorted_keys[j - 1]; --j)
+            {
+                std::swap(sorted_keys[j], sorted_keys[j - 1]);
+                std::swap(sorted_binders[j], sorted_binders[j - 1]);
+            }
+        }
+    }
+
+private:
+    template<size_t I>
+    static void bind_at(const ini_field_list& list, const ini_parser::section_view& section, Struct& out,
+        std::optional<ini_parser::key_handle> handle, std::vector<std::string>& problems)
+    {
+        ini_bind_field(section, out, std::get<I>(list.fields), handle, problems);
+    }
+
+    template<size_t... I>
+    constexpr void fill_binders(std::index_sequence<I...>)
+    {
+        ((sorted_binders[I] = &bind_at<I>), ...);
+    }
+};
+
+template<typename Struct, typename... Types>
+constexpr ini_field_list<Struct, Types...> ini_fields(ini_field<Struct, Types>... fields)
+{
+    return ini_field_list<Struct, Types...>(fields...);
+}
+
+// Заполнение структуры из секции за один поиск секции и один проход по ее
+// записям: и записи, и ключи полей упорядочены, поэтому они сопоставляются
+// слиянием. Отсутствующие обязательные ключи и непреобразуемые значения
+// собираются в одно исключение ini_schema_error; остальные поля записываются
+template<typename Struct, typename... Types>
+void ini_bind(const ini_parser::section_view& section, Struct& out, const ini_field_list<Struct, Types...>& fields)
+{
+    std::vector<std::string> problems;
+    ini_parser::section_view::iterator it = section.begin();
+    ini_parser::section_view::iterator end = section.end();
+
+    for (size_t i = 0; i < fields.size; ++i)
+    {
+        std::string_view key = fields.sorted_keys[i];
+
+        int order = 1;
+
+        while (it != end && (order = ini_compare_keys((*it).key, key)) < 0)
+        {
+            ++it;
+        }
+
+        std::optional<ini_parser::key_handle> handle;
+
+        if (it != end && order == 0)
+        {
+            handle = (*it).handle;
+        }
+
+        fields.sorted_binders[i](fields, section, out, handle, problems);
+    }
+
+    if (!problems.empty())
+    {
+        throw ini_schema_error(std::move(problems));
+    }
+}
+
+// То же по имени секции (ошибки отсутствия секции - как у get_section)
+template<typename Struct, typename... Types>
+void ini_bind(const ini_parser& parser, std::string_view section, Struct& out, const ini_field_list<Struct, Types...>& fields)
+{
+    ini_bind(parser.get_section(section), out, fields);
+}
@@ -0,0 +1,127 @@
+#include "ini_concurrent_parser.h"
+
+// Номера версий уникальны во всем процессе, поэтому кеш потока не спутает
+// снимки разных объектов, даже если один объект создан на месте другого
+static std::atomic<uint64_t> next_snapshot_version{ 1 };
+static std::atomic<uint64_t> next_instance_id{ 1 };
+
+ini_concurrent_parser::ini_concurrent_parser(const std::string& filename, const ini_parser_options& options)
+    : current_version(0), instance_id(next_instance_id.fetch_add(1))
+{
+    auto state = std::make_shared<snapshot_state>(filename, options);
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    publish(std::move(state));
+}
+
+// Читателей объекта в момент уничтожения нет, поэтому ячейки потоков можно
+// менять отсюда: поток больше не обратится к ячейке и только удалит ее
+ini_concurrent_parser::~ini_concurrent_parser()
+{
+    std::lock_guard<std::mutex> lock(readers_mutex);
+
+    for (const std::weak_ptr<reader_slot>& reader : readers)
+    {
+        if (std::shared_ptr<reader_slot> slot = reader.lock())
+        {
+            slot->cached.reset();
+            slot->released.store(true, std::memory_order_release);
+        }
+    }
+}
+
+// Ячейки завершившихся потоков удаляются при регистрации новой
+std::shared_ptr<ini_concurrent_parser::reader_slot> ini_concurrent_parser::register_reader() const
+{
+    auto slot = std::make_shared<reader_slot>();
+    std::lock_guard<std::mutex> lock(readers_mutex);
+    std::erase_if(readers, [](const std::weak_ptr<reader_slot>& reader) { return reader.expired(); });
+    readers.push_back(slot);
+    return slot;
+}
+
+// Вызывается под writer_mutex, поэтому номера версий публикуются по возрастанию.
+// Сначала публикуется снимок, затем его версия: читатель, увидевший новую версию,
+// гарантированно получит снимок не старее нее
+void ini_concurrent_parser::publish(std::shared_ptr<snapshot_state> state)
+{
+    uint64_t version = next_snapshot_version.fetch_add(1);
+    state->version = version;
+    current.store(std::move(state), std::memory_order_release);
+    current_version.store(version, std::memory_order_release);
+}
+
+std::shared_ptr<const ini_parser> ini_concurrent_parser::snapshot() const
+{
+    std::shared_ptr<const snapshot_state> state = current.load(std::memory_order_acquire);
+    return std::shared_ptr<const ini_parser>(state, &state->parser);
+}
+
+void ini_concurrent_parser::set_value(std::string_view key_path, std::string_view value)
+{
+    update([&](ini_parser& parser)
+    {
+        parser.set_value(key_path, value);
+    });
+}
+
+// Копия и публикация идут под одной блокировкой писателей, иначе параллельная
+// запись могла бы опубликовать снимок, который эта копия затем затрет
+void ini_concurrent_parser::update(const std::function<void(ini_parser&)>& change)
+{
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    auto state = std::make_shared<snapshot_state>(current.load(std::memory_order_acquire)->parser);
+    change(state->parser);
+    publish(std::move(state));
+}
+
+std::shared_ptr<const ini_parser> ini_concurrent_parser::load(const std::string& filename, const ini_parser_options& options)
+{
+    auto state = std::make_shared<snapshot_state>(filename, options);
+    std::shared_ptr<const ini_parser> result(state, &state->parser);
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    publish(std::move(state));
+    return result;
+}
+
+// Быстрый путь - ячейка объекта в кеше потока (обычно первая) и сравнение версии
+// с закешированной; медленный (после публикации) один раз загружает новый снимок
+// в ячейку. У потока своя ячейка для каждого объекта, поэтому чтение нескольких
+// объектов поочередно не сбрасывает кеш
+const ini_parser& ini_concurrent_parser::local_snapshot() const
+{
+    struct thread_slot
+    {
+        uint64_t instance;
+        std::shared_ptr<reader_slot> slot;
+    };
+
+    thread_local std::vector<thread_slot> slots;
+    size_t index = 0;
+
+    while (index < slots.size() && slots[index].instance != instance_id)
+    {
+        index++;
+    }
+
+    if (index == slots.size())
+    {
+        // Ячейки уничтоженных объектов больше не понадобятся
+        std::erase_if(slots, [](const thread_slot& item) { return item.slot->released.load(std::memory_order_acquire); });
+        slots.insert(slots.begin(), { instance_id, register_reader() });
+        index = 0;
+    }
+    else if (index != 0)
+    {
+        std::swap(slots[0], slots[index]);
+        index = 0;
+    }
+
+    std::shared_ptr<const snapshot_state>& cached = slots[index].slot->cached;
+
+    if (!cached || cached->version != current_version.load(std::memory_order_acquire))
+    {
+        cached = current.load(std::memory_order_acquire);
+    }
+
+    return cached->parser;
+}
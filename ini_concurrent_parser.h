@@ -0,0 +1,126 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <optional>
+#include <vector>
+#include <cstdint>
+#include "ini_parser.h"
+
+// Тип значения, указывающий в память снимка (std::string_view и списки из
+// них). Из методов чтения без удерживаемого снимка такие значения не выдаются:
+// следующее чтение в том же потоке может освободить снимок
+template<typename T>
+constexpr bool ini_value_borrows = false;
+
+template<>
+constexpr bool ini_value_borrows<std::string_view> = true;
+
+template<>
+constexpr bool ini_value_borrows<std::vector<std::string_view>> = true;
+
+// Конфигурация для общего доступа из многих потоков.
+// Гарантии: все методы можно вызывать из любых потоков одновременно.
+// Чтение (get_value, try_get_value) не берет блокировок и в обычном случае
+// не меняет общих данных: поток хранит последний прочитанный снимок и сверяет
+// его с номером версии одним атомарным чтением, поэтому читатели не мешают
+// друг другу (общие данные меняются только при первом чтении потока из объекта
+// и после публикации). Запись копирует текущий снимок, изменяет копию и публикует ее
+// атомарной заменой указателя (copy-on-write); писатели выполняются по одному,
+// каждая запись стоит копии конфигурации, поэтому серию изменений лучше
+// объединять через update(). Читатель видит либо старый, либо новый снимок
+// целиком; для согласованного чтения нескольких ключей и для значений,
+// указывающих в снимок (std::string_view), служит snapshot().
+// Цена кеша потока: поток, читавший объект, удерживает последний прочитанный
+// снимок (весь парсер вместе с отображением файла) до следующего чтения,
+// своего завершения или уничтожения объекта
+class ini_concurrent_parser
+{
+private:
+    // Снимок с глобально уникальным номером версии
+    struct snapshot_state
+    {
+        ini_parser parser;
+        uint64_t version = 0;
+
+        template<typename... Args>
+        explicit snapshot_state(Args&&... args)
+            : parser(std::forward<Args>(args)...)
+        {
+        }
+    };
+
+    std::atomic<std::shared_ptr<const snapshot_state>> current;
+    std::atomic<uint64_t> current_version;
+    std::mutex writer_mutex; // Публикации идут по одному
+
+    // Снимок, закешированный одним потоком для этого объекта. Ячейку держит
+    // поток (до своего завершения), объект ссылается на нее слабо, чтобы при
+    // уничтожении освободить снимок и пометить ячейку устаревшей
+    struct reader_slot
+    {
+        std::shared_ptr<const snapshot_state> cached;
+        std::atomic<bool> released{ false };
+    };
+
+    // Номер объекта для кеша потока: уникален в процессе, поэтому объект,
+    // созданный на месте уничтоженного, не получит чужую ячейку
+    const uint64_t instance_id;
+    mutable std::mutex readers_mutex;
+    mutable std::vector<std::weak_ptr<reader_slot>> readers;
+
+    std::shared_ptr<reader_slot> register_reader() const; // Новая ячейка кеша потока
+
+    void publish(std::shared_ptr<snapshot_state> state); // Присвоение версии и атомарная замена снимка (под writer_mutex)
+    const ini_parser& local_snapshot() const; // Снимок, закешированный текущим потоком
+
+public:
+    explicit ini_concurrent_parser(const std::string& filename, const ini_parser_options& options = {});
+
+    // Освобождает снимки, закешированные потоками
+    ~ini_concurrent_parser();
+
+    ini_concurrent_parser(const ini_concurrent_parser&) = delete;
+    ini_concurrent_parser& operator=(const ini_concurrent_parser&) = delete;
+
+    // Текущий снимок; удерживает его целиком для серии согласованных чтений
+    // и значений std::string_view, действительных, пока жив указатель
+    std::shared_ptr<const ini_parser> snapshot() const;
+
+    // Номер версии текущего снимка (растет при каждой публикации)
+    uint64_t version() const
+    {
+        return current_version.load(std::memory_order_acquire);
+    }
+
+    // Чтение значения из текущего снимка. Значения, указывающие в снимок
+    // (ini_value_borrows), читаются через snapshot()
+    template<typename T>
+    T get_value(std::string_view key_path) const
+    {
+        static_assert(!ini_value_borrows<T>, "Значение указывает в снимок: читайте его через snapshot()");
+        return local_snapshot().get_value<T>(key_path);
+    }
+
+    template<typename T>
+    std::optional<T> try_get_value(std::string_view key_path) const
+    {
+        static_assert(!ini_value_borrows<T>, "Значение указывает в снимок: читайте его через snapshot()");
+        return local_snapshot().try_get_value<T>(key_path);
+    }
+
+    // Изменение одного значения (см. ini_parser::set_value)
+    void set_value(std::string_view key_path, std::string_view value);
+
+    // Серия изменений над одной копией; если change выбросит исключение,
+    // снимок не меняется
+    void update(const std::function<void(ini_parser&)>& change);
+
+    // Замена конфигурации новым разбором файла (разбор идет до захвата блокировки).
+    // Возвращает опубликованный снимок
+    std::shared_ptr<const ini_parser> load(const std::string& filename, const ini_parser_options& options);
+};
@@ -0,0 +1,374 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cstring>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <array>
+
+// Разбор числа через std::from_chars: строка должна быть прочитана целиком
+template<typename T>
+bool ini_from_chars(const char* first, const char* last, T& out)
+{
+    if (first == last)
+    {
+        return false;
+    }
+
+    auto [ptr, ec] = std::from_chars(first, last, out);
+    return ec == std::errc() && ptr == last;
+}
+
+// Пропуск необязательного знака '+' (std::from_chars его не принимает)
+inline const char* ini_skip_plus(const char* first, const char* last)
+{
+    if (first != last && *first == '+')
+    {
+        ++first;
+
+        // Вариант "+-5" некорректен
+        if (first != last && *first == '-')
+        {
+            return nullptr;
+        }
+    }
+    return first;
+}
+
+// Разбор целого числа без учета локали, исключений и выделения памяти
+template<typename T>
+bool ini_parse_integer(std::string_view str, T& out)
+{
+    const char* last = str.data() + str.size();
+    const char* first = ini_skip_plus(str.data(), last);
+    return first != nullptr && ini_from_chars(first, last, out);
+}
+
+// Разбор числа с плавающей точкой; запятая допускается как десятичный разделитель
+template<typename T>
+bool ini_parse_floating(std::string_view str, T& out)
+{
+    const char* last = str.data() + str.size();
+    const char* first = ini_skip_plus(str.data(), last);
+
+    if (first == nullptr)
+    {
+        return false;
+    }
+
+    const char* comma = static_cast<const char*>(std::memchr(first, ',', static_cast<size_t>(last - first)));
+
+    if (comma == nullptr)
+    {
+        return ini_from_chars(first, last, out);
+    }
+
+    // Запятую заменяем на точку в копии на стеке; числа длиннее буфера
+    // на практике не встречаются, для них допустима копия в куче
+    char buffer[64];
+    size_t length = static_cast<size_t>(last - first);
+
+    if (length > sizeof(buffer))
+    {
+        std::string normalized(first, last);
+        normalized[comma - first] = '.';
+        return ini_from_chars(normalized.data(), normalized.data() + length, out);
+    }
+
+    std::memcpy(buffer, first, length);
+    buffer[comma - first] = '.';
+    return ini_from_chars(buffer, buffer + length, out);
+}
+
+// Сравнение без учета регистра только для ASCII, независимо от локали процесса
+inline bool ini_iequals(std::string_view str, std::string_view lower)
+{
+    if (str.size() != lower.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        char c = str[i];
+
+        if (c >= 'A' && c <= 'Z')
+        {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+
+        if (c != lower[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Правила преобразования строкового значения в тип T:
+//   name       - имя типа для сообщений об ошибках;
+//   parse      - разбор без исключений (false при ошибке);
+//   cache_type - тип, в котором значение хранится в кеше записи
+//                (целые хранятся расширенными, чтобы разные типы делили ячейку);
+//   cache_slot - номер ячейки кеша (-1 - значение не кешируется).
+// Для поддержки нового типа достаточно специализировать этот шаблон
+template<typename T>
+struct ini_value_traits
+{
+    static_assert(sizeof(T) == -1, "Не реализовано преобразование для этого типа");
+};
+
+// Номера ячеек кеша преобразованных значений
+constexpr int ini_cache_slot_signed = 0;
+constexpr int ini_cache_slot_unsigned = 1;
+constexpr int ini_cache_slot_double = 2;
+constexpr int ini_cache_slot_float = 3;
+constexpr int ini_cache_slot_bool = 4;
+constexpr int ini_cache_slot_count = 5;
+
+// Общие правила для целых типов: в кеше лежит long long или unsigned long long
+template<typename T>
+struct ini_integer_traits
+{
+    using cache_type = std::conditional_t<std::is_signed_v<T>, long long, unsigned long long>;
+    static constexpr int cache_slot = std::is_signed_v<T> ? ini_cache_slot_signed : ini_cache_slot_unsigned;
+
+    static bool parse(std::string_view str, T& out)
+    {
+        return ini_parse_integer(str, out);
+    }
+
+    // Сужение значения из кеша с проверкой диапазона
+    static bool from_cache(cache_type wide, T& out)
+    {
+        if (!std::in_range<T>(wide))
+        {
+            return false;
+        }
+
+        out = static_cast<T>(wide);
+        return true;
+    }
+};
+
+// Общие правила для чисел с плавающей точкой
+template<typename T, int Slot>
+struct ini_floating_traits
+{
+    using cache_type = T;
+    static constexpr int cache_slot = Slot;
+
+    static bool parse(std::string_view str, T& out)
+    {
+        return ini_parse_floating(str, out);
+    }
+
+    static bool from_cache(cache_type value, T& out)
+    {
+        out = value;
+        return true;
+    }
+};
+
+template<> struct ini_value_traits<short> : ini_integer_traits<short> { static constexpr const char* name = "short"; };
+template<> struct ini_value_traits<unsigned short> : ini_integer_traits<unsigned short> { static constexpr const char* name = "unsigned short"; };
+template<> struct ini_value_traits<int> : ini_integer_traits<int> { static constexpr const char* name = "int"; };
+template<> struct ini_value_traits<unsigned int> : ini_integer_traits<unsigned int> { static constexpr const char* name = "unsigned int"; };
+template<> struct ini_value_traits<long> : ini_integer_traits<long> { static constexpr const char* name = "long"; };
+template<> struct ini_value_traits<unsigned long> : ini_integer_traits<unsigned long> { static constexpr const char* name = "unsigned long"; };
+template<> struct ini_value_traits<long long> : ini_integer_traits<long long> { static constexpr const char* name = "long long"; };
+template<> struct ini_value_traits<unsigned long long> : ini_integer_traits<unsigned long long> { static constexpr const char* name = "unsigned long long"; };
+
+template<> struct ini_value_traits<float> : ini_floating_traits<float, ini_cache_slot_float> { static constexpr const char* name = "float"; };
+template<> struct ini_value_traits<double> : ini_floating_traits<double, ini_cache_slot_double> { static constexpr const char* name = "double"; };
+
+// long double не помещается в ячейку кеша и разбирается при каждом обращении
+template<>
+struct ini_value_traits<long double>
+{
+    static constexpr const char* name = "long double";
+    static constexpr int cache_slot = -1;
+
+    static bool parse(std::string_view str, long double& out)
+    {
+        return ini_parse_floating(str, out);
+    }
+};
+
+// Строки: копия значения
+template<>
+struct ini_value_traits<std::string>
+{
+    static constexpr const char* name = "string";
+    static constexpr int cache_slot = -1;
+
+    static bool parse(std::string_view str, std::string& out)
+    {
+        out.assign(str);
+        return true;
+    }
+};
+
+// Представление значения без копирования; действительно, пока жив парсер
+template<>
+struct ini_value_traits<std::string_view>
+{
+    static constexpr const char* name = "string_view";
+    static constexpr int cache_slot = -1;
+
+    static bool parse(std::string_view str, std::string_view& out)
+    {
+        out = str;
+        return true;
+    }
+};
+
+// Булевы значения: true/false, 1/0, yes/no, on/off без учета регистра
+template<>
+struct ini_value_traits<bool>
+{
+    static constexpr const char* name = "bool";
+    using cache_type = bool;
+    static constexpr int cache_slot = ini_cache_slot_bool;
+
+    static bool parse(std::string_view str, bool& out)
+    {
+        // Поддерживаем разные форматы true
+        if (ini_iequals(str, "true") || str == "1" || ini_iequals(str, "yes") || ini_iequals(str, "on"))
+        {
+            out = true;
+            return true;
+        }
+
+        // Поддерживаем разные форматы false
+        if (ini_iequals(str, "false") || str == "0" || ini_iequals(str, "no") || ini_iequals(str, "off"))
+        {
+            out = false;
+            return true;
+        }
+
+        return false;
+    }
+
+    static bool from_cache(cache_type value, bool& out)
+    {
+        out = value;
+        return true;
+    }
+};
+
+// Разделитель элементов списка ("hosts = a, b, c"). В списках чисел десятичный
+// разделитель - только точка: запятая отделяет элементы
+constexpr char ini_list_separator = ',';
+
+// Число элементов списка; пустое значение - пустой список
+inline size_t ini_list_size(std::string_view str)
+{
+    if (str.empty())
+    {
+        return 0;
+    }
+
+    size_t count = 1;
+
+    for (const char* pos = str.data(); (pos = static_cast<const char*>(
+        std::memchr(pos, ini_list_separator, static_cast<size_t>(str.data() + str.size() - pos)))) != nullptr; ++pos)
+    {
+        count++;
+    }
+
+    return count;
+}
+
+// Обход элементов списка без пробелов и табуляций по краям: visit(номер, элемент)
+// возвращает false, чтобы прервать обход; тогда и результат - false
+template<typename Visit>
+bool ini_for_each_item(std::string_view str, Visit&& visit)
+{
+    if (str.empty())
+    {
+        return true;
+    }
+
+    size_t index = 0;
+
+    for (size_t begin = 0;; ++index)
+    {
+        size_t end = str.find(ini_list_separator, begin);
+        std::string_view item = str.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+        size_t first = item.find_first_not_of(" \t");
+        item = first == std::string_view::npos ? std::string_view() : item.substr(first, item.find_last_not_of(" \t") - first + 1);
+
+        if (!visit(index, item))
+        {
+            return false;
+        }
+
+        if (end == std::string_view::npos)
+        {
+            return true;
+        }
+
+        begin = end + 1;
+    }
+}
+
+// Имя "vector<T>" для сообщений об ошибках
+template<typename T>
+struct ini_list_name
+{
+    static constexpr std::string_view element = ini_value_traits<T>::name;
+
+    static constexpr std::array<char, element.size() + 9> value = []
+    {
+        std::array<char, element.size() + 9> result{};
+        std::string_view prefix = "vector<";
+        size_t pos = 0;
+
+        for (char c : prefix)
+        {
+            result[pos++] = c;
+        }
+
+        for (char c : element)
+        {
+            result[pos++] = c;
+        }
+
+        result[pos] = '>';
+        return result;
+    }();
+};
+
+// Список значений одного типа через ini_list_separator. ini_parser хранит
+// разобранные списки в кеше записи (ini_parser::get_array), здесь - разбор
+// без кеша для остальных потребителей правил
+template<typename T>
+struct ini_value_traits<std::vector<T>>
+{
+    static constexpr const char* name = ini_list_name<T>::value.data();
+    static constexpr int cache_slot = -1;
+
+    static bool parse(std::string_view str, std::vector<T>& out)
+    {
+        out.clear();
+        out.reserve(ini_list_size(str));
+
+        return ini_for_each_item(str, [&out](size_t, std::string_view item)
+        {
+            T value;
+
+            if (!ini_value_traits<T>::parse(item, value))
+            {
+                return false;
+            }
+
+            out.push_back(std::move(value));
+            return true;
+        });
+    }
+};
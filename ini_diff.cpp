@@ -0,0 +1,141 @@
+#include "ini_diff.h"
+#include <string>
+#include <algorithm>
+#include <utility>
+
+// Все ключи секции как добавленные или удаленные
+static void add_section_keys(ini_diff& diff, const ini_parser::section_view& section, ini_change kind)
+{
+    for (ini_parser::section_view::item item : section)
+    {
+        if (kind == ini_change::added)
+        {
+            diff.keys.push_back({ kind, section.name(), item.key, {}, item.value });
+        }
+        else
+        {
+            diff.keys.push_back({ kind, section.name(), item.key, item.value, {} });
+        }
+    }
+}
+
+// Слияние записей секции: обе стороны упорядочены по ключу
+static void compare_section(ini_diff& diff, const ini_parser::section_view& before, const ini_parser::section_view& after)
+{
+    ini_parser::section_view::iterator old_it = before.begin();
+    ini_parser::section_view::iterator new_it = after.begin();
+    std::string_view name = before.name();
+
+    while (old_it != before.end() || new_it != after.end())
+    {
+        if (new_it == after.end() || (old_it != before.end() && (*old_it).key < (*new_it).key))
+        {
+            diff.keys.push_back({ ini_change::removed, name, (*old_it).key, (*old_it).value, {} });
+            ++old_it;
+        }
+        else if (old_it == before.end() || (*new_it).key < (*old_it).key)
+        {
+            diff.keys.push_back({ ini_change::added, name, (*new_it).key, {}, (*new_it).value });
+            ++new_it;
+        }
+        else
+        {
+            if ((*old_it).value != (*new_it).value)
+            {
+                diff.keys.push_back({ ini_change::changed, name, (*old_it).key, (*old_it).value, (*new_it).value });
+            }
+
+            ++old_it;
+            ++new_it;
+        }
+    }
+}
+
+// Секции по алфавиту (ленивый парсер перечисляет их в порядке файла)
+static std::vector<ini_parser::section_view> sorted_sections(const ini_parser& parser)
+{
+    std::vector<ini_parser::section_view> sections = parser.sections();
+    auto by_name = [](const ini_parser::section_view& a, const ini_parser::section_view& b)
+    {
+        return a.name() < b.name();
+    };
+
+    if (!std::is_sorted(sections.begin(), sections.end(), by_name))
+    {
+        std::sort(sections.begin(), sections.end(), by_name);
+    }
+
+    return sections;
+}
+
+ini_diff ini_compare(const ini_parser& before, const ini_parser& after)
+{
+    ini_diff diff;
+    std::vector<ini_parser::section_view> old_sections = sorted_sections(before);
+    std::vector<ini_parser::section_view> new_sections = sorted_sections(after);
+    auto old_it = old_sections.begin();
+    auto new_it = new_sections.begin();
+
+    // Слияние упорядоченных по имени секций без поиска по имени
+    while (old_it != old_sections.end() || new_it != new_sections.end())
+    {
+        if (new_it == new_sections.end() || (old_it != old_sections.end() && old_it->name() < new_it->name()))
+        {
+            diff.removed_sections.push_back(old_it->name());
+            add_section_keys(diff, *old_it++, ini_change::removed);
+        }
+        else if (old_it == old_sections.end() || new_it->name() < old_it->name())
+        {
+            diff.added_sections.push_back(new_it->name());
+            add_section_keys(diff, *new_it++, ini_change::added);
+        }
+        else
+        {
+            if (old_it->size() == new_it->size() && old_it->content_hash() == new_it->content_hash())
+            {
+                diff.unchanged_sections++;
+            }
+            else
+            {
+                compare_section(diff, *old_it, *new_it);
+            }
+
+            ++old_it;
+            ++new_it;
+        }
+    }
+
+    return diff;
+}
+
+void ini_diff::apply(ini_parser& target) const
+{
+    std::vector<std::string> paths;
+    std::vector<std::pair<std::string_view, std::string_view>> values;
+    std::vector<std::string_view> removed;
+    paths.reserve(keys.size()); // Без перевыделения: values и removed указывают в строки paths
+
+    for (const ini_key_change& change : keys)
+    {
+        paths.push_back(std::string(change.section).append(".").append(change.key));
+
+        if (change.kind == ini_change::removed)
+        {
+            removed.push_back(paths.back());
+        }
+        else
+        {
+            values.emplace_back(paths.back(), change.new_value);
+        }
+    }
+
+    // set_values проверяет весь набор до изменений, поэтому при ошибке target
+    // не меняется; удаления идут после. Каждый ключ встречается в разнице один
+    // раз, так что порядок установки и удаления не важен
+    target.set_values(values);
+
+    for (std::string_view path : removed)
+    {
+        target.remove_key(path);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include "ini_parser.h"
+
+// Вид изменения ключа
+enum class ini_change
+{
+    added,   // Ключа не было (old_value пусто)
+    removed, // Ключ удален (new_value пусто)
+    changed  // Изменилось значение
+};
+
+// Изменение одного ключа; строки указывают в память сравниваемых парсеров
+struct ini_key_change
+{
+    ini_change kind;
+    std::string_view section;
+    std::string_view key;
+    std::string_view old_value;
+    std::string_view new_value;
+};
+
+// Структурная разница двух конфигураций. Действительна, пока живы оба парсера
+struct ini_diff
+{
+    std::vector<std::string_view> added_sections;   // Секции, которых не было
+    std::vector<std::string_view> removed_sections; // Секции, которых не стало
+    std::vector<ini_key_change> keys;               // Все изменения ключей, в том числе ключей добавленных и удаленных секций
+    size_t unchanged_sections = 0;                  // Секции, пропущенные по совпадению хеша содержимого
+
+    bool empty() const
+    {
+        return added_sections.empty() && removed_sections.empty() && keys.empty();
+    }
+
+    // Применение изменений ключей к target через remove_key и set_values, например
+    // к локально измененной копии старой конфигурации. Пустые секции не
+    // создаются и не удаляются: ini_parser хранит секцию только вместе с ключами.
+    // Новые значения проверяются до изменений: при ошибке target не меняется
+    void apply(ini_parser& target) const;
+};
+
+// Разница между before и after. Общие секции сравниваются по хешу содержимого
+// (section_view::content_hash), поэтому неизмененная секция пропускается одним
+// сравнением, а сравнение записей идет только в измененных секциях - слиянием
+// двух упорядоченных по ключу массивов. Секции сопоставляются слиянием имен по
+// алфавиту, и в этом же порядке идут изменения ключей (внутри секции - по ключу).
+// Ленивые парсеры при сравнении разбирают все секции (ошибка разбора выбрасывается)
+ini_diff ini_compare(const ini_parser& before, const ini_parser& after);
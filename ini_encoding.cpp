@@ -0,0 +1,344 @@
+#include "ini_encoding.h"
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INI_ENCODING_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define INI_ENCODING_NEON
+#include <arm_neon.h>
+#endif
+
+// Кодовые точки байтов 0x80-0xFF в CP1251; 0 - байт не назначен (0x98)
+static const uint16_t cp1251_high[128] =
+{
+    0x0402, 0x0403, 0x201A, 0x0453, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x20AC, 0x2030, 0x0409, 0x2039, 0x040A, 0x040C, 0x040B, 0x040F,
+    0x0452, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x0000, 0x2122, 0x0459, 0x203A, 0x045A, 0x045C, 0x045B, 0x045F,
+    0x00A0, 0x040E, 0x045E, 0x0408, 0x00A4, 0x0490, 0x00A6, 0x00A7,
+    0x0401, 0x00A9, 0x0404, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x0407,
+    0x00B0, 0x00B1, 0x0406, 0x0456, 0x0491, 0x00B5, 0x00B6, 0x00B7,
+    0x0451, 0x2116, 0x0454, 0x00BB, 0x0458, 0x0405, 0x0455, 0x0457,
+    0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+    0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F,
+    0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427,
+    0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+    0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+    0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+    0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+};
+
+const char* ini_encoding_name(ini_encoding encoding)
+{
+    switch (encoding)
+    {
+    case ini_encoding::auto_detect: return "auto";
+    case ini_encoding::utf8: return "utf-8";
+    case ini_encoding::utf16le: return "utf-16le";
+    case ini_encoding::utf16be: return "utf-16be";
+    case ini_encoding::cp1251: return "cp1251";
+    }
+    return "";
+}
+
+ini_encoding ini_detect_bom(std::string_view text, size_t& bom_size)
+{
+    if (text.size() >= 3 && text.substr(0, 3) == "\xEF\xBB\xBF")
+    {
+        bom_size = 3;
+        return ini_encoding::utf8;
+    }
+
+    if (text.size() >= 2 && text.substr(0, 2) == "\xFF\xFE")
+    {
+        bom_size = 2;
+        return ini_encoding::utf16le;
+    }
+
+    if (text.size() >= 2 && text.substr(0, 2) == "\xFE\xFF")
+    {
+        bom_size = 2;
+        return ini_encoding::utf16be;
+    }
+
+    bom_size = 0;
+    return ini_encoding::auto_detect;
+}
+
+// Число байт ASCII подряд с позиции from: векторно по 16 байт, остаток - словами по 8
+static size_t ascii_run(const unsigned char* text, size_t from, size_t size)
+{
+    size_t pos = from;
+
+#if defined(INI_ENCODING_SSE2)
+    for (; pos + 16 <= size; pos += 16)
+    {
+        int high = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos)));
+
+        if (high != 0)
+        {
+            return pos + static_cast<size_t>(std::countr_zero(static_cast<unsigned>(high))) - from;
+        }
+    }
+#elif defined(INI_ENCODING_NEON)
+    for (; pos + 16 <= size; pos += 16)
+    {
+        if (vmaxvq_u8(vld1q_u8(text + pos)) >= 0x80)
+        {
+            break;
+        }
+    }
+#endif
+
+    for (; pos + 8 <= size; pos += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, text + pos, 8);
+
+        if ((word & 0x8080808080808080ull) != 0)
+        {
+            break;
+        }
+    }
+
+    while (pos < size && text[pos] < 0x80)
+    {
+        pos++;
+    }
+
+    return pos - from;
+}
+
+// Длина корректной последовательности UTF-8 с позиции pos (0 - последовательность некорректна)
+static size_t utf8_sequence(const unsigned char* text, size_t pos, size_t size)
+{
+    unsigned char lead = text[pos];
+    size_t length;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+
+    if (lead >= 0xC2 && lead <= 0xDF)
+    {
+        length = 2;
+    }
+    else if (lead >= 0xE0 && lead <= 0xEF)
+    {
+        // Избыточная запись и суррогаты D800-DFFF
+        length = 3;
+        low = lead == 0xE0 ? 0xA0 : 0x80;
+        high = lead == 0xED ? 0x9F : 0xBF;
+    }
+    else if (lead >= 0xF0 && lead <= 0xF4)
+    {
+        // Избыточная запись и кодовые точки больше U+10FFFF
+        length = 4;
+        low = lead == 0xF0 ? 0x90 : 0x80;
+        high = lead == 0xF4 ? 0x8F : 0xBF;
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (size - pos < length || text[pos + 1] < low || text[pos + 1] > high)
+    {
+        return 0;
+    }
+
+    for (size_t i = 2; i < length; ++i)
+    {
+        if ((text[pos + i] & 0xC0) != 0x80)
+        {
+            return 0;
+        }
+    }
+
+    return length;
+}
+
+size_t ini_find_invalid_utf8(std::string_view text)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text.data());
+    size_t size = text.size();
+    size_t pos = 0;
+
+    while (pos < size)
+    {
+        pos += ascii_run(bytes, pos, size);
+
+        if (pos == size)
+        {
+            break;
+        }
+
+        // Слова не из ASCII идут подряд: к векторной проверке - только после них
+        while (pos < size && bytes[pos] >= 0x80)
+        {
+            size_t length = utf8_sequence(bytes, pos, size);
+
+            if (length == 0)
+            {
+                return pos;
+            }
+
+            pos += length;
+        }
+    }
+
+    return std::string_view::npos;
+}
+
+// Запись кодовой точки в UTF-8
+static char* put_utf8(char* out, uint32_t code)
+{
+    if (code < 0x80)
+    {
+        *out++ = static_cast<char>(code);
+    }
+    else if (code < 0x800)
+    {
+        *out++ = static_cast<char>(0xC0 | (code >> 6));
+        *out++ = static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000)
+    {
+        *out++ = static_cast<char>(0xE0 | (code >> 12));
+        *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else
+    {
+        *out++ = static_cast<char>(0xF0 | (code >> 18));
+        *out++ = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (code & 0x3F));
+    }
+
+    return out;
+}
+
+// CP1251: участки ASCII копируются целиком, остальные байты - по таблице
+// (не больше трех байт UTF-8 на байт)
+static size_t transcode_cp1251(std::string_view text, std::pmr::vector<char>& out)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text.data());
+    size_t size = text.size();
+    out.resize(size * 3);
+    char* dst = out.data();
+
+    for (size_t pos = 0; pos < size;)
+    {
+        size_t run = ascii_run(bytes, pos, size);
+        std::memcpy(dst, bytes + pos, run);
+        dst += run;
+        pos += run;
+
+        for (; pos < size && bytes[pos] >= 0x80; ++pos)
+        {
+            uint16_t code = cp1251_high[bytes[pos] - 0x80];
+
+            if (code == 0)
+            {
+                return pos;
+            }
+
+            dst = put_utf8(dst, code);
+        }
+    }
+
+    out.resize(static_cast<size_t>(dst - out.data()));
+    return std::string_view::npos;
+}
+
+// UTF-16: по восемь символов ASCII сжимаются векторно, остальные кодируются
+// по одному с разбором суррогатных пар (не больше трех байт UTF-8 на два байта)
+static size_t transcode_utf16(std::string_view text, bool big_endian, std::pmr::vector<char>& out)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text.data());
+    size_t units = text.size() / 2;
+    out.resize(units * 3);
+    char* dst = out.data();
+
+    auto unit_at = [bytes, big_endian](size_t i)
+    {
+        return big_endian ? static_cast<uint32_t>(bytes[2 * i] << 8 | bytes[2 * i + 1])
+                          : static_cast<uint32_t>(bytes[2 * i + 1] << 8 | bytes[2 * i]);
+    };
+
+    for (size_t i = 0; i < units;)
+    {
+#if defined(INI_ENCODING_SSE2)
+        const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+
+        while (i + 8 <= units)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 2 * i));
+
+            if (big_endian)
+            {
+                v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            }
+
+            __m128i is_ascii = _mm_cmpeq_epi16(_mm_and_si128(v, non_ascii), _mm_setzero_si128());
+
+            if (_mm_movemask_epi8(is_ascii) != 0xFFFF)
+            {
+                break;
+            }
+
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(v, v));
+            dst += 8;
+            i += 8;
+        }
+
+        if (i == units)
+        {
+            break;
+        }
+#endif
+
+        uint32_t code = unit_at(i);
+
+        if (code >= 0xD800 && code <= 0xDBFF)
+        {
+            uint32_t low = i + 1 < units ? unit_at(i + 1) : 0;
+
+            if (low < 0xDC00 || low > 0xDFFF)
+            {
+                return 2 * i;
+            }
+
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            i++;
+        }
+        else if (code >= 0xDC00 && code <= 0xDFFF)
+        {
+            return 2 * i;
+        }
+
+        dst = put_utf8(dst, code);
+        i++;
+    }
+
+    out.resize(static_cast<size_t>(dst - out.data()));
+    return text.size() % 2 != 0 ? text.size() - 1 : std::string_view::npos;
+}
+
+size_t ini_transcode_to_utf8(std::string_view text, ini_encoding encoding, std::pmr::vector<char>& out)
+{
+    switch (encoding)
+    {
+    case ini_encoding::cp1251:
+        return transcode_cp1251(text, out);
+    case ini_encoding::utf16le:
+    case ini_encoding::utf16be:
+        return transcode_utf16(text, encoding == ini_encoding::utf16be, out);
+    default:
+        out.assign(text.begin(), text.end());
+        return ini_find_invalid_utf8(text);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <memory_resource>
+#include <cstddef>
+
+// Кодировка текста конфигурации. Разбор и поиск всегда работают с UTF-8,
+// текст в другой кодировке перекодируется при загрузке
+enum class ini_encoding
+{
+    auto_detect, // По BOM; текст без BOM - UTF-8, а если он не является корректным UTF-8 - CP1251
+    utf8,
+    utf16le,
+    utf16be,
+    cp1251
+};
+
+// Название кодировки для диагностики
+const char* ini_encoding_name(ini_encoding encoding);
+
+// Кодировка по метке порядка байт в начале текста (auto_detect, если метки нет)
+// и размер метки в байтах
+ini_encoding ini_detect_bom(std::string_view text, size_t& bom_size);
+
+// Позиция первого байта некорректной последовательности UTF-8 (неполной,
+// избыточной, суррогатной или больше U+10FFFF); std::string_view::npos, если
+// текст корректен. Участки ASCII проверяются векторно по 16 байт
+size_t ini_find_invalid_utf8(std::string_view text);
+
+// Перекодирование text (без BOM) из encoding в UTF-8 с заменой содержимого out.
+// Участки ASCII копируются векторно. Результат - позиция первого байта, который
+// не удалось перекодировать (одиночный суррогат, нечетная длина UTF-16, байт
+// 0x98 в CP1251), или std::string_view::npos
+size_t ini_transcode_to_utf8(std::string_view text, ini_encoding encoding, std::pmr::vector<char>& out);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+// Класс для обработки ошибок парсера
+class ini_parser_error : public std::runtime_error
+{
+public:
+    // Конструктор с сообщением об ошибке и необязательным номером строки
+    explicit ini_parser_error(const std::string& msg, int line = -1)
+        : std::runtime_error(line == -1 ? msg : "Ошибка в строке " + std::to_string(line) + ": " + msg)
+    {
+    }
+};
+
+// Ошибка разбора без исключения: номер строки и текст. Разбор сообщает только
+// постоянные тексты, поэтому запись ошибки ничего не выделяет
+struct ini_diagnostic
+{
+    int line;
+    const char* message;
+
+    ini_parser_error to_error() const
+    {
+        return ini_parser_error(message, line);
+    }
+};
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <istream>
+#include <cstring>
+#include "ini_error.h"
+#include "ini_scanner.h"
+
+// Проверка имени секции: текст ошибки или nullptr, если имя корректно;
+// has_space - результат разметки сканером
+inline const char* ini_section_name_error(std::string_view name, bool has_space)
+{
+    // Имя секции не может быть пустым
+    if (name.empty())
+    {
+        return "Пустое имя секции";
+    }
+
+    // Имя секции не должно содержать пробелов
+    if (has_space)
+    {
+        return "Имя секции содержит пробелы";
+    }
+
+    return nullptr;
+}
+
+// Проверка имени ключа: текст ошибки или nullptr, если имя корректно
+inline const char* ini_key_name_error(std::string_view name, bool has_space)
+{
+    // Ключ не может быть пустым
+    if (name.empty())
+    {
+        return "Пустой ключ";
+    }
+
+    // Ключ не должен содержать пробелов
+    if (has_space)
+    {
+        return "Ключ содержит пробелы";
+    }
+
+    return nullptr;
+}
+
+// Разбор строки-заголовка секции (первый непробельный символ - '['): текст ошибки
+// или nullptr. name присваивается, если заголовок закрыт ']'
+inline const char* ini_parse_section_header(const ini_line_scanner& scanner, std::string_view buffer,
+    const ini_scanned_line& line, std::string_view& name)
+{
+    // Проверяем что секция закрыта
+    if (line.last - line.first < 2 || buffer[line.last - 1] != ']')
+    {
+        return "Некорректное объявление секции - отсутствует ']'";
+    }
+
+    // Извлекаем имя секции
+    size_t name_first = scanner.find_not_blank(line.first + 1, line.last - 1);
+    size_t name_last = scanner.find_last_not_blank(name_first, line.last - 1);
+    name = buffer.substr(name_first, name_last - name_first);
+    return ini_section_name_error(name, scanner.has_space(name_first, name_last));
+}
+
+// Обработчик событий разбора по умолчанию: события пропускаются, ошибка
+// выбрасывает ini_parser_error. Собственный обработчик наследуется от него
+// и определяет только нужные методы - вызовы разрешаются при компиляции,
+// без виртуальных функций. Строки в событиях указывают в разбираемый буфер
+// и при чтении из потока действительны только во время вызова
+struct ini_event_visitor
+{
+    void on_section(std::string_view name, int line)
+    {
+        (void)name;
+        (void)line;
+    }
+
+    void on_key_value(std::string_view section, std::string_view key, std::string_view value, int line)
+    {
+        (void)section;
+        (void)key;
+        (void)value;
+        (void)line;
+    }
+
+    // Текст комментария после ';' без пробелов в конце
+    void on_comment(std::string_view text, int line)
+    {
+        (void)text;
+        (void)line;
+    }
+
+    // Если обработчик не выбросит исключение, строка пропускается и разбор
+    // продолжается; ключи после некорректной секции проверяются, но не передаются
+    void on_error(const char* message, int line)
+    {
+        throw ini_parser_error(message, line);
+    }
+};
+
+// Обработчик директив: строки, первый непробельный символ которых '!', передаются
+// в on_directive(текст после '!', номер строки) вместо разбора как ключ-значение.
+// У ini_event_visitor такого метода нет, поэтому обычный разбор директив не знает
+template<typename Handler>
+concept ini_directive_handler = requires(Handler& handler, std::string_view text, int line)
+{
+    handler.on_directive(text, line);
+};
+
+// Разбор текста в поток событий. Текст подается фрагментами из целых строк
+// (последний фрагмент может не заканчиваться переводом строки); номера строк
+// и текущая секция переходят от фрагмента к фрагменту
+template<typename Handler>
+class ini_event_reader
+{
+private:
+    Handler& handler;
+    std::string_view section; // Текущая секция (пустая до первой секции)
+    bool section_valid;       // Текущая секция объявлена корректно
+    int line_num;
+
+public:
+    explicit ini_event_reader(Handler& handler, int first_line = 1)
+        : handler(handler), section_valid(false), line_num(first_line - 1)
+    {
+    }
+
+    // Текущая секция; если ее строка перестанет существовать (следующий фрагмент
+    // читается в тот же буфер), имя нужно перенести через set_section
+    std::string_view current_section() const
+    {
+        return section;
+    }
+
+    void set_section(std::string_view name)
+    {
+        section = name;
+    }
+
+    // Номер последней разобранной строки
+    int line() const
+    {
+        return line_num;
+    }
+
+    // Разбор фрагмента; границы строк, пробелов и '=' дает сканер
+    void feed(std::string_view buffer)
+    {
+        ini_line_scanner scanner(buffer);
+        ini_scanned_line line;
+
+        while (scanner.next(line))
+        {
+            line_num++;
+
+            // Пропускаем пустые строки
+            if (line.first == line.last)
+            {
+                continue;
+            }
+
+            // Комментарии
+            if (buffer[line.first] == ';')
+            {
+                handler.on_comment(buffer.substr(line.first + 1, line.last - line.first - 1), line_num);
+                continue;
+            }
+
+            // Директивы, если обработчик их принимает
+            if constexpr (ini_directive_handler<Handler>)
+            {
+                if (buffer[line.first] == '!')
+                {
+                    handler.on_directive(buffer.substr(line.first + 1, line.last - line.first - 1), line_num);
+                    continue;
+                }
+            }
+
+            // Обработка секции
+            if (buffer[line.first] == '[')
+            {
+                section_valid = false;
+
+                if (const char* error = ini_parse_section_header(scanner, buffer, line, section))
+                {
+                    handler.on_error(error, line_num);
+                    continue;
+                }
+
+                section_valid = true;
+                handler.on_section(section, line_num);
+                continue;
+            }
+
+            // Проверяем что ключ-значение находится внутри секции
+            if (section.empty())
+            {
+                handler.on_error("Ключ-значение вне секции", line_num);
+                continue;
+            }
+
+            // Разделяем ключ и значение
+            size_t eq_pos = scanner.find_equals(line.first, line.last);
+
+            if (eq_pos == std::string_view::npos)
+            {
+                handler.on_error("Некорректный формат строки (отсутствует '=')", line_num);
+                continue;
+            }
+
+            size_t key_last = scanner.find_last_not_blank(line.first, eq_pos);
+            size_t value_first = scanner.find_not_blank(eq_pos + 1, line.last);
+            std::string_view key = buffer.substr(line.first, key_last - line.first);
+
+            if (const char* error = ini_key_name_error(key, scanner.has_space(line.first, key_last)))
+            {
+                handler.on_error(error, line_num);
+                continue;
+            }
+
+            if (section_valid)
+            {
+                handler.on_key_value(section, key, buffer.substr(value_first, line.last - value_first), line_num);
+            }
+        }
+    }
+};
+
+// Разбор буфера целиком
+template<typename Handler>
+void ini_read_events(std::string_view buffer, Handler& handler)
+{
+    ini_event_reader<Handler> reader(handler);
+    reader.feed(buffer);
+}
+
+// Потоковый разбор с памятью, ограниченной размером блока и самой длинной строки:
+// поток читается блоками, обрабатываются целые строки, незаконченная строка
+// переносится в начало буфера, а имя текущей секции - в отдельную строку
+template<typename Handler>
+void ini_read_events(std::istream& stream, Handler& handler, size_t block_size = 64 * 1024)
+{
+    ini_event_reader<Handler> reader(handler);
+    std::vector<char> buffer(block_size);
+    std::string section;
+    size_t used = 0;
+
+    for (;;)
+    {
+        // Строка длиннее буфера: буфер растет
+        if (used == buffer.size())
+        {
+            buffer.resize(buffer.size() * 2);
+        }
+
+        stream.read(buffer.data() + used, static_cast<std::streamsize>(buffer.size() - used));
+        used += static_cast<size_t>(stream.gcount());
+
+        bool finished = !stream;
+        std::string_view text(buffer.data(), used);
+        size_t complete = used;
+
+        if (!finished)
+        {
+            size_t last_newline = text.rfind('\n');
+            complete = last_newline == std::string_view::npos ? 0 : last_newline + 1;
+        }
+
+        if (complete != 0)
+        {
+            reader.feed(text.substr(0, complete));
+
+            section.assign(reader.current_section());
+            reader.set_section(section);
+
+            std::memmove(buffer.data(), buffer.data() + complete, used - complete);
+            used -= complete;
+        }
+
+        if (finished)
+        {
+            return;
+        }
+    }
+}
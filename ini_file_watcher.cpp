@@ -0,0 +1,311 @@
+#include "ini_file_watcher.h"
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#endif
+
+// Разделение пути на каталог и имя файла
+static void split_path(const std::string& filename, std::string& directory, std::string& file_name)
+{
+    std::filesystem::path path(filename);
+    directory = path.has_parent_path() ? path.parent_path().string() : std::string(".");
+    file_name = path.filename().string();
+}
+
+// Сколько осталось ждать до истечения срока (не меньше нуля)
+static long long remaining_ms(std::chrono::steady_clock::time_point deadline)
+{
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    return std::max<long long>(0, left.count());
+}
+
+#ifdef _WIN32
+
+ini_file_watcher::ini_file_watcher(const std::string& filename, std::chrono::milliseconds debounce, std::function<void()> on_change)
+    : debounce(debounce), on_change(std::move(on_change))
+{
+    split_path(filename, directory, file_name);
+
+    HANDLE handle = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Не удалось начать наблюдение за каталогом: " + directory);
+    }
+
+    directory_handle = handle;
+    stop_event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+    if (stop_event == nullptr)
+    {
+        CloseHandle(handle);
+        throw std::runtime_error("Не удалось начать наблюдение за каталогом: " + directory);
+    }
+
+    worker = std::thread([this] { watch_loop(); });
+}
+
+ini_file_watcher::~ini_file_watcher()
+{
+    SetEvent(stop_event);
+    worker.join();
+    CloseHandle(stop_event);
+    CloseHandle(directory_handle);
+}
+
+// Асинхронный ReadDirectoryChangesW с ожиданием завершения или сигнала остановки
+void ini_file_watcher::watch_loop()
+{
+    const DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE;
+    const std::wstring wide_name = std::filesystem::path(file_name).wstring();
+
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+    if (overlapped.hEvent == nullptr)
+    {
+        return;
+    }
+
+    alignas(DWORD) char buffer[16384];
+    bool reading = false;
+    bool pending = false;
+    std::chrono::steady_clock::time_point deadline;
+
+    for (;;)
+    {
+        if (!reading)
+        {
+            ResetEvent(overlapped.hEvent);
+
+            if (!ReadDirectoryChangesW(directory_handle, buffer, sizeof(buffer), FALSE, filter, nullptr, &overlapped, nullptr))
+            {
+                break;
+            }
+
+            reading = true;
+        }
+
+        HANDLE handles[2] = { stop_event, overlapped.hEvent };
+        DWORD timeout = pending ? static_cast<DWORD>(remaining_ms(deadline)) : INFINITE;
+        DWORD result = WaitForMultipleObjects(2, handles, FALSE, timeout);
+
+        if (result == WAIT_TIMEOUT)
+        {
+            pending = false;
+            on_change();
+            continue;
+        }
+
+        if (result != WAIT_OBJECT_0 + 1)
+        {
+            break;
+        }
+
+        DWORD bytes = 0;
+        reading = false;
+
+        if (!GetOverlappedResult(directory_handle, &overlapped, &bytes, FALSE))
+        {
+            break;
+        }
+
+        // Нулевой размер означает переполнение буфера: изменения могли затронуть файл
+        bool changed = bytes == 0;
+
+        for (DWORD offset = 0; bytes != 0 && !changed; )
+        {
+            const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer + offset);
+            int length = static_cast<int>(info->FileNameLength / sizeof(WCHAR));
+
+            changed = CompareStringOrdinal(info->FileName, length, wide_name.c_str(), static_cast<int>(wide_name.size()), TRUE) == CSTR_EQUAL;
+
+            if (info->NextEntryOffset == 0)
+            {
+                break;
+            }
+
+            offset += info->NextEntryOffset;
+        }
+
+        if (changed)
+        {
+            pending = true;
+            deadline = std::chrono::steady_clock::now() + debounce;
+        }
+    }
+
+    if (reading)
+    {
+        DWORD bytes = 0;
+        CancelIoEx(directory_handle, &overlapped);
+        GetOverlappedResult(directory_handle, &overlapped, &bytes, TRUE);
+    }
+
+    CloseHandle(overlapped.hEvent);
+}
+
+#elif defined(__linux__)
+
+ini_file_watcher::ini_file_watcher(const std::string& filename, std::chrono::milliseconds debounce, std::function<void()> on_change)
+    : debounce(debounce), on_change(std::move(on_change))
+{
+    split_path(filename, directory, file_name);
+
+    inotify_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stop_descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    // Завершение записи и переименование поверх файла - моменты, когда файл готов к чтению
+    if (inotify_descriptor < 0 || stop_descriptor < 0 ||
+        inotify_add_watch(inotify_descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        if (inotify_descriptor >= 0)
+        {
+            ::close(inotify_descriptor);
+        }
+
+        if (stop_descriptor >= 0)
+        {
+            ::close(stop_descriptor);
+        }
+
+        throw std::runtime_error("Не удалось начать наблюдение за каталогом: " + directory);
+    }
+
+    worker = std::thread([this] { watch_loop(); });
+}
+
+ini_file_watcher::~ini_file_watcher()
+{
+    uint64_t signal = 1;
+    (void)::write(stop_descriptor, &signal, sizeof(signal));
+    worker.join();
+    ::close(inotify_descriptor);
+    ::close(stop_descriptor);
+}
+
+// Ожидание событий inotify или сигнала остановки через poll
+void ini_file_watcher::watch_loop()
+{
+    bool pending = false;
+    std::chrono::steady_clock::time_point deadline;
+
+    for (;;)
+    {
+        pollfd descriptors[2] = {
+            { inotify_descriptor, POLLIN, 0 },
+            { stop_descriptor, POLLIN, 0 }
+        };
+
+        int timeout = pending ? static_cast<int>(remaining_ms(deadline)) : -1;
+        int ready = ::poll(descriptors, 2, timeout);
+
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+
+        if (descriptors[1].revents != 0)
+        {
+            return;
+        }
+
+        if (ready == 0)
+        {
+            pending = false;
+            on_change();
+            continue;
+        }
+
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+
+        while ((length = ::read(inotify_descriptor, buffer, sizeof(buffer))) > 0)
+        {
+            for (ssize_t offset = 0; offset < length; )
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+
+                // Переполнение очереди: изменения могли затронуть файл
+                if ((event->mask & IN_Q_OVERFLOW) != 0 || (event->len != 0 && file_name == event->name))
+                {
+                    pending = true;
+                    deadline = std::chrono::steady_clock::now() + debounce;
+                }
+
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+}
+
+#else
+
+ini_file_watcher::ini_file_watcher(const std::string& filename, std::chrono::milliseconds debounce, std::function<void()> on_change)
+    : debounce(debounce), on_change(std::move(on_change))
+{
+    split_path(filename, directory, file_name);
+    worker = std::thread([this] { watch_loop(); });
+}
+
+ini_file_watcher::~ini_file_watcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex);
+        stopping = true;
+    }
+
+    stop_signal.notify_all();
+    worker.join();
+}
+
+// Периодический опрос времени изменения и размера файла
+void ini_file_watcher::watch_loop()
+{
+    const std::filesystem::path path = std::filesystem::path(directory) / file_name;
+    const auto interval = std::max(debounce, std::chrono::milliseconds(250));
+
+    auto stamp = [&path]
+    {
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(path, error);
+        auto size = std::filesystem::file_size(path, error);
+        return std::make_pair(time, size);
+    };
+
+    auto last = stamp();
+    std::unique_lock<std::mutex> lock(stop_mutex);
+
+    while (!stop_signal.wait_for(lock, interval, [this] { return stopping; }))
+    {
+        auto current = stamp();
+
+        if (current != last)
+        {
+            last = current;
+            lock.unlock();
+            on_change();
+            lock.lock();
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Наблюдение за файлом в фоновом потоке.
+// Следит за каталогом файла, а не за самим файлом: редакторы обычно сохраняют
+// через запись во временный файл и переименование, и наблюдение за старым
+// файлом теряется. Серия событий, пришедших в пределах debounce, сводится
+// к одному вызову on_change (из потока наблюдателя; on_change не должен
+// выбрасывать исключений)
+class ini_file_watcher
+{
+private:
+    std::string directory;
+    std::string file_name;
+    std::chrono::milliseconds debounce;
+    std::function<void()> on_change;
+
+#ifdef _WIN32
+    void* directory_handle = nullptr;
+    void* stop_event = nullptr;
+#elif defined(__linux__)
+    int inotify_descriptor = -1;
+    int stop_descriptor = -1;
+#else
+    // Опрос времени изменения файла
+    std::mutex stop_mutex;
+    std::condition_variable stop_signal;
+    bool stopping = false;
+#endif
+
+    std::thread worker;
+
+    void watch_loop(); // Цикл ожидания событий файловой системы
+
+public:
+    ini_file_watcher(const std::string& filename, std::chrono::milliseconds debounce, std::function<void()> on_change);
+    ~ini_file_watcher();
+
+    ini_file_watcher(const ini_file_watcher&) = delete;
+    ini_file_watcher& operator=(const ini_file_watcher&) = delete;
+};
@@ -0,0 +1,305 @@
+#include "ini_mapped_file.h"
+#include <utility>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+ini_mapped_file::ini_mapped_file()
+    : mapped_data(nullptr), mapped_size(0), file_handle(INVALID_HANDLE_VALUE), mapping_handle(nullptr)
+{
+}
+
+ini_mapped_file::ini_mapped_file(ini_mapped_file&& other) noexcept
+    : mapped_data(std::exchange(other.mapped_data, nullptr)),
+      mapped_size(std::exchange(other.mapped_size, 0)),
+      file_handle(std::exchange(other.file_handle, INVALID_HANDLE_VALUE)),
+      mapping_handle(std::exchange(other.mapping_handle, nullptr))
+{
+}
+
+ini_mapped_file& ini_mapped_file::operator=(ini_mapped_file&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        mapped_data = std::exchange(other.mapped_data, nullptr);
+        mapped_size = std::exchange(other.mapped_size, 0);
+        file_handle = std::exchange(other.file_handle, INVALID_HANDLE_VALUE);
+        mapping_handle = std::exchange(other.mapping_handle, nullptr);
+    }
+    return *this;
+}
+
+// Открытие файла и создание представления только для чтения
+bool ini_mapped_file::open(const std::string& filename)
+{
+    close();
+
+    file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(file_handle, &size))
+    {
+        close();
+        return false;
+    }
+
+    // Пустой файл отобразить нельзя, но это корректный пустой конфиг
+    if (size.QuadPart == 0)
+    {
+        return true;
+    }
+
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping_handle == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+
+    if (view == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    mapped_data = static_cast<const char*>(view);
+    mapped_size = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+// Чтение файла по размеру, полученному при открытии; файл, выросший
+// за время чтения, дочитывается блоками
+bool ini_read_file(const std::string& filename, std::pmr::vector<char>& buffer)
+{
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    bool ok = GetFileSizeEx(file, &size) != 0;
+    size_t used = 0;
+
+    if (ok)
+    {
+        buffer.reserve(static_cast<size_t>(size.QuadPart) + 1);
+        buffer.resize(static_cast<size_t>(size.QuadPart) + 1);
+    }
+
+    while (ok)
+    {
+        if (used == buffer.size())
+        {
+            buffer.resize(buffer.size() * 2);
+        }
+
+        DWORD request = static_cast<DWORD>(std::min<size_t>(buffer.size() - used, MAXDWORD));
+        DWORD read = 0;
+        ok = ReadFile(file, buffer.data() + used, request, &read, nullptr) != 0;
+
+        if (read == 0)
+        {
+            break;
+        }
+
+        used += read;
+    }
+
+    CloseHandle(file);
+    buffer.resize(used);
+    return ok;
+}
+
+// Освобождение представления и дескрипторов
+void ini_mapped_file::close()
+{
+    if (mapped_data != nullptr)
+    {
+        UnmapViewOfFile(mapped_data);
+        mapped_data = nullptr;
+    }
+
+    mapped_size = 0;
+
+    if (mapping_handle != nullptr)
+    {
+        CloseHandle(mapping_handle);
+        mapping_handle = nullptr;
+    }
+
+    if (file_handle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file_handle);
+        file_handle = INVALID_HANDLE_VALUE;
+    }
+}
+
+#else
+
+ini_mapped_file::ini_mapped_file()
+    : mapped_data(nullptr), mapped_size(0), file_descriptor(-1)
+{
+}
+
+ini_mapped_file::ini_mapped_file(ini_mapped_file&& other) noexcept
+    : mapped_data(std::exchange(other.mapped_data, nullptr)),
+      mapped_size(std::exchange(other.mapped_size, 0)),
+      file_descriptor(std::exchange(other.file_descriptor, -1))
+{
+}
+
+ini_mapped_file& ini_mapped_file::operator=(ini_mapped_file&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        mapped_data = std::exchange(other.mapped_data, nullptr);
+        mapped_size = std::exchange(other.mapped_size, 0);
+        file_descriptor = std::exchange(other.file_descriptor, -1);
+    }
+    return *this;
+}
+
+// Открытие файла и отображение его в память только для чтения
+bool ini_mapped_file::open(const std::string& filename)
+{
+    close();
+
+    file_descriptor = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (file_descriptor == -1)
+    {
+        return false;
+    }
+
+    struct stat info;
+
+    if (fstat(file_descriptor, &info) != 0)
+    {
+        close();
+        return false;
+    }
+
+    // Пустой файл отобразить нельзя, но это корректный пустой конфиг
+    if (info.st_size == 0)
+    {
+        return true;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+
+    if (view == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+
+    // Файл читается один раз от начала до конца
+    madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+    mapped_data = static_cast<const char*>(view);
+    mapped_size = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+// Чтение файла по размеру из fstat; файл, выросший за время чтения,
+// дочитывается блоками
+bool ini_read_file(const std::string& filename, std::pmr::vector<char>& buffer)
+{
+    int file = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (file == -1)
+    {
+        return false;
+    }
+
+    struct stat info;
+    bool ok = fstat(file, &info) == 0;
+    size_t used = 0;
+
+    // Лишний байт позволяет увидеть конец файла за один вызов read
+    if (ok)
+    {
+        buffer.reserve(static_cast<size_t>(info.st_size) + 1);
+        buffer.resize(static_cast<size_t>(info.st_size) + 1);
+    }
+
+    while (ok)
+    {
+        if (used == buffer.size())
+        {
+            buffer.resize(buffer.size() * 2);
+        }
+
+        ssize_t count = ::read(file, buffer.data() + used, buffer.size() - used);
+
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        ok = count >= 0;
+
+        if (count <= 0)
+        {
+            break;
+        }
+
+        used += static_cast<size_t>(count);
+    }
+
+    ::close(file);
+    buffer.resize(used);
+    return ok;
+}
+
+// Освобождение отображения и дескриптора
+void ini_mapped_file::close()
+{
+    if (mapped_data != nullptr)
+    {
+        munmap(const_cast<char*>(mapped_data), mapped_size);
+        mapped_data = nullptr;
+    }
+
+    mapped_size = 0;
+
+    if (file_descriptor != -1)
+    {
+        ::close(file_descriptor);
+        file_descriptor = -1;
+    }
+}
+
+#endif
+
+ini_mapped_file::~ini_mapped_file()
+{
+    close();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory_resource>
+#include <cstddef>
+
+// Файл, отображенный в память только для чтения (mmap в Linux, MapViewOfFile в Windows)
+class ini_mapped_file
+{
+private:
+    // Начало отображенной области и ее размер
+    const char* mapped_data;
+    size_t mapped_size;
+
+#ifdef _WIN32
+    // Дескрипторы файла и объекта отображения
+    void* file_handle;
+    void* mapping_handle;
+#else
+    // Файловый дескриптор
+    int file_descriptor;
+#endif
+
+    void close(); // Освобождение отображения и дескрипторов
+
+public:
+    ini_mapped_file();
+    ~ini_mapped_file();
+
+    // Отображение нельзя копировать, но можно перемещать: адрес данных при этом не меняется
+    ini_mapped_file(const ini_mapped_file&) = delete;
+    ini_mapped_file& operator=(const ini_mapped_file&) = delete;
+    ini_mapped_file(ini_mapped_file&& other) noexcept;
+    ini_mapped_file& operator=(ini_mapped_file&& other) noexcept;
+
+    // Открытие и отображение файла, false если файл не удалось открыть
+    bool open(const std::string& filename);
+
+    // Содержимое файла (пустое для пустого файла)
+    std::string_view view() const
+    {
+        return std::string_view(mapped_data, mapped_size);
+    }
+};
+
+// Чтение файла целиком в buffer прямыми системными вызовами, без буферов
+// и локали std::ifstream: для небольших файлов это заметная часть загрузки.
+// Буфер выделяется по размеру файла один раз; false, если файл не удалось
+// открыть или прочитать
+bool ini_read_file(const std::string& filename, std::pmr::vector<char>& buffer);
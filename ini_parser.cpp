@@ -1,555 +1,2269 @@
 #include <iostream>
 #include "ini_parser.h"
-#include <locale>
-#include <codecvt>
+#include "ini_scanner.h"
+#include "ini_events.h"
+#include "ini_thread_pool.h"
+#include "ini_encoding.h"
+#include <filesystem>
+
+// Встроенная конфигурация по умолчанию
+static const char default_config_text[] = R"(
+[Section1]
+; Пример секции с русскими комментариями
+var1 = 5
+var2 = Привет, мир!
+
+[Section2]
+var1 = 42
+var2 = Тестовая строка
+)";
+
+// Проверка корректности имени секции; has_space - результат разметки сканером
+void ini_parser::validate_section_name(std::string_view name, bool has_space, int line_num)
+{
+    if (const char* error = ini_section_name_error(name, has_space))
+    {
+        throw ini_parser_error(error, line_num);
+    }
+}
+
+// Проверка корректности имени ключа; has_space - результат разметки сканером
+void ini_parser::validate_key_name(std::string_view name, bool has_space, int line_num)
+{
+    if (const char* error = ini_key_name_error(name, has_space))
+    {
+        throw ini_parser_error(error, line_num);
+    }
+}
+
+// Номер строки с позицией offset в тексте кодировки encoding
+static int encoding_error_line(std::string_view text, ini_encoding encoding, size_t offset)
+{
+    if (encoding != ini_encoding::utf16le && encoding != ini_encoding::utf16be)
+    {
+        return static_cast<int>(std::count(text.begin(), text.begin() + offset, '\n')) + 1;
+    }
+
+    size_t low_byte = encoding == ini_encoding::utf16le ? 0 : 1;
+    int line = 1;
+
+    for (size_t i = 0; i + 1 < offset; i += 2)
+    {
+        line += text[i + low_byte] == '\n' && text[i + 1 - low_byte] == '\0';
+    }
+
+    return line;
+}
+
+// Текст в UTF-8 без BOM: представление в raw или перекодированный текст в converted.
+// detected - кодировка исходного текста; некорректный текст - ini_parser_error
+static std::string_view decode_to_utf8(std::string_view raw, ini_encoding declared,
+    std::pmr::vector<char>& converted, ini_encoding& detected)
+{
+    size_t bom_size;
+    ini_encoding encoding = ini_detect_bom(raw, bom_size);
+    std::string_view text = raw.substr(bom_size);
+
+    if (encoding == ini_encoding::auto_detect)
+    {
+        encoding = declared;
+    }
+
+    size_t error;
+
+    // UTF-8 разбирается на месте; без BOM и указанной кодировки
+    // некорректный UTF-8 считается текстом в CP1251
+    if (encoding == ini_encoding::auto_detect || encoding == ini_encoding::utf8)
+    {
+        error = ini_find_invalid_utf8(text);
+
+        if (error == std::string_view::npos)
+        {
+            detected = ini_encoding::utf8;
+            return text;
+        }
+
+        if (encoding == ini_encoding::utf8)
+        {
+            throw ini_parser_error("Некорректный текст в кодировке utf-8", encoding_error_line(text, encoding, error));
+        }
+
+        encoding = ini_encoding::cp1251;
+    }
+
+    error = ini_transcode_to_utf8(text, encoding, converted);
+
+    if (error != std::string_view::npos)
+    {
+        throw ini_parser_error(std::string("Некорректный текст в кодировке ") + ini_encoding_name(encoding),
+            encoding_error_line(text, encoding, error));
+    }
+
+    detected = encoding;
+    return std::string_view(converted.data(), converted.size());
+}
+
+// Перекодированный текст заменяет собой содержимое owned_buffer (raw может
+// указывать в него и после вызова недействителен); UTF-8 остается на месте
+std::string_view ini_parser::decode_text(std::string_view raw, ini_encoding encoding)
+{
+    ini_stage_timer timer(counters, ini_parse_stage::read);
+    std::pmr::vector<char> converted(resource);
+    std::string_view text = decode_to_utf8(raw, encoding, converted, text_encoding);
+
+    if (text_encoding == ini_encoding::utf8)
+    {
+        return text;
+    }
+
+    owned_buffer.swap(converted);
+    return std::string_view(owned_buffer.data(), owned_buffer.size());
+}
+
+// Чтение потока целиком в собственный буфер и его разбор
+void ini_parser::parse_file(std::istream& stream, unsigned threads, ini_encoding encoding)
+{
+    const size_t chunk_size = 64 * 1024;
+    size_t used = 0;
+    std::optional<ini_stage_timer> timer(std::in_place, counters, ini_parse_stage::read);
+
+    // Для файла размер известен заранее: буфер выделяется один раз, что важно
+    // для арены, которая не переиспользует память после роста вектора
+    std::streampos start = stream.tellg();
+    size_t expected = 0;
+
+    if (start != std::streampos(-1) && stream.seekg(0, std::ios::end))
+    {
+        std::streamoff size = stream.tellg() - start;
+        stream.seekg(start);
+
+        if (size > 0)
+        {
+            expected = static_cast<size_t>(size);
+            owned_buffer.reserve(expected + 1);
+        }
+    }
+
+    stream.clear();
+
+    // Читаем крупными блоками вместо построчного std::getline (при отслеживании
+    // хода загрузки - блоками progress_block_size)
+    while (stream)
+    {
+        if (used == owned_buffer.size())
+        {
+            owned_buffer.resize(owned_buffer.capacity() > used ? owned_buffer.capacity() : used + chunk_size);
+        }
+
+        size_t request = owned_buffer.size() - used;
+
+        if (load_progress != nullptr)
+        {
+            request = std::min(request, progress_block_size);
+        }
+
+        stream.read(owned_buffer.data() + used, static_cast<std::streamsize>(request));
+        used += static_cast<size_t>(stream.gcount());
+        report_progress(ini_parse_stage::read, used, std::max(expected, used));
+    }
+
+    owned_buffer.resize(used);
+    timer.reset();
+    parse_buffer(decode_text(std::string_view(owned_buffer.data(), owned_buffer.size()), encoding), threads);
+}
+
+// Без сбора ошибок первая ошибка разбора выбрасывается
+void ini_parser::throw_first_diagnostic() const
+{
+    if (!collect_errors && !load_diagnostics.empty())
+    {
+        throw load_diagnostics.front().to_error();
+    }
+}
+
+// Кеш прежних записей больше не нужен: вместе с ним освобождаются все списки
+// и сбрасываются хеши секций
+void ini_parser::reset_value_cache()
+{
+    value_cache.clear();
+    value_cache.resize(data.all_entries().size());
+    section_hashes.clear();
+    section_hashes.resize(data.all_sections().size());
+    arrays->pool.release();
+}
+
+void ini_parser::release_arrays(typed_cache& cache)
+{
+    const array_cache* node = cache.arrays.exchange(nullptr, std::memory_order_relaxed);
+
+    while (node != nullptr)
+    {
+        const array_cache* next = node->next;
+        arrays->pool.deallocate(const_cast<array_cache*>(node), node->bytes, array_alignment);
+        node = next;
+    }
+}
+
+// Список строится один раз на запись и тип элементов. Пул использует тот же
+// ресурс, что и разбор ленивых секций, поэтому в ленивом режиме блокировка общая
+const ini_parser::array_cache* ini_parser::build_array(const entry_ref& ref, const void* type, size_t item_size,
+    bool (*parse_item)(std::string_view, void*), size_t& bad_item) const
+{
+    std::lock_guard<std::mutex> lock(lazy_mutex ? *lazy_mutex : arrays->mutex);
+    const array_cache* head = ref.cache->arrays.load(std::memory_order_relaxed);
+
+    for (const array_cache* node = head; node != nullptr; node = node->next)
+    {
+        if (node->type == type)
+        {
+            return node;
+        }
+    }
+
+    // Заголовок занимает первые array_alignment байт блока, элементы - остаток,
+    // округленный до array_alignment и дополненный нулями
+    std::string_view value = ref.entry->value;
+    size_t size = ini_list_size(value);
+    size_t items_bytes = (size * item_size + array_alignment - 1) / array_alignment * array_alignment;
+    size_t bytes = array_alignment + items_bytes;
+    char* block = static_cast<char*>(arrays->pool.allocate(bytes, array_alignment));
+    char* items = block + array_alignment;
+
+    bool parsed = ini_for_each_item(value, [&](size_t index, std::string_view item)
+    {
+        bad_item = index;
+        return parse_item(item, items + index * item_size);
+    });
+
+    if (!parsed)
+    {
+        arrays->pool.deallocate(block, bytes, array_alignment);
+        return nullptr;
+    }
+
+    std::memset(items + size * item_size, 0, items_bytes - size * item_size);
+    const array_cache* node = ::new (block) array_cache{ head, type, items, size, bytes };
+    ref.cache->arrays.store(node, std::memory_order_release);
+    return node;
+}
+
+void ini_parser::report_progress(ini_parse_stage stage, uint64_t done, uint64_t total) const
+{
+    if (load_progress != nullptr)
+    {
+        (*load_progress)(stage, done, total);
+    }
+}
+
+// Потребитель событий разбора, наполняющий хранилище. Ошибки записываются
+// в список, и разбор продолжается: в цикле разбора нет выбрасывания исключений
+struct ini_storage_builder : ini_event_visitor
+{
+    ini_storage& target;
+    std::vector<ini_diagnostic>& diagnostics;
+
+    ini_storage_builder(ini_storage& target, std::vector<ini_diagnostic>& diagnostics)
+        : target(target), diagnostics(diagnostics)
+    {
+    }
+
+    void on_section(std::string_view name, int)
+    {
+        target.add_section(name);
+    }
+
+    void on_key_value(std::string_view section, std::string_view key, std::string_view value, int line)
+    {
+        target.add_value(section, key, value, static_cast<uint32_t>(line));
+    }
+
+    void on_error(const char* message, int line)
+    {
+        diagnostics.push_back({ line, message });
+    }
+};
+
+// Разбор фрагмента текста в хранилище target: строки, секции, ключи и значения -
+// представления в buffer. first_line - номер первой строки фрагмента в файле,
+// ошибки дописываются в diagnostics по порядку строк.
+// ini_parser - один из потребителей общего потока событий ini_event_reader
+void ini_parser::parse_chunk(std::string_view buffer, int first_line, ini_storage& target,
+    std::vector<ini_diagnostic>& diagnostics)
+{
+    ini_storage_builder builder(target, diagnostics);
+    ini_event_reader<ini_storage_builder> reader(builder, first_line);
+    reader.feed(buffer);
+}
+
+// Начало первой корректной строки-заголовка секции в диапазоне [begin, end) и
+// число переводов строк до нее. Некорректный заголовок не годится как граница:
+// последовательный разбор после него проверяет ключи, не сохраняя их, а часть,
+// начатая с него, сообщила бы о каждом ключе "вне секции"
+static size_t find_section_start(std::string_view buffer, size_t begin, size_t end, size_t& lines_before)
+{
+    // Первое начало строки не раньше begin
+    size_t line_start = begin;
+
+    if (begin != 0 && buffer[begin - 1] != '\n')
+    {
+        size_t line_end = buffer.find('\n', begin);
+        line_start = line_end == std::string_view::npos ? buffer.size() : line_end + 1;
+    }
+
+    lines_before = static_cast<size_t>(std::count(buffer.begin() + begin, buffer.begin() + std::min(line_start, end), '\n'));
+
+    if (line_start >= end)
+    {
+        return std::string_view::npos;
+    }
+
+    std::string_view rest = buffer.substr(line_start);
+    ini_line_scanner scanner(rest);
+    ini_scanned_line line;
+
+    std::string_view name;
+
+    while (scanner.next(line) && line_start + line.begin < end)
+    {
+        if (line.first != line.end && rest[line.first] == '[' && ini_parse_section_header(scanner, rest, line, name) == nullptr)
+        {
+            return line_start + line.begin;
+        }
+
+        lines_before++;
+    }
+
+    return std::string_view::npos;
+}
+
+// Основной метод парсинга: последовательный или параллельный по границам секций.
+// Ошибки строк собираются за один проход; без collect_errors выбрасывается
+// первая из них
+void ini_parser::parse_buffer(std::string_view buffer, unsigned threads)
+{
+    counters.add_text(buffer);
+    load_diagnostics.clear();
+    source_text = buffer;
+    value_patches.clear();
+    layout_changed = false;
+
+    if (lazy)
+    {
+        build_lazy_index(buffer);
+        report_progress(ini_parse_stage::tokenize, buffer.size(), buffer.size());
+        return;
+    }
+
+    ini_thread_pool* pool = nullptr;
+
+    if (threads != 1 && buffer.size() >= parallel_parse_min_size)
+    {
+        pool = &ini_thread_pool::shared();
+        threads = threads == 0 ? pool->size() + 1 : threads;
+    }
+
+    if (pool == nullptr)
+    {
+        {
+            ini_stage_timer timer(counters, ini_parse_stage::tokenize);
+
+            if (load_progress == nullptr)
+            {
+                parse_chunk(buffer, 1, data, load_diagnostics);
+            }
+            else
+            {
+                // Разбор блоками из целых строк с сообщением после каждого
+                ini_storage_builder builder(data, load_diagnostics);
+                ini_event_reader<ini_storage_builder> reader(builder);
+
+                for (size_t done = 0; done < buffer.size();)
+                {
+                    size_t end = buffer.find('\n', std::min(buffer.size() - 1, done + progress_block_size));
+                    end = end == std::string_view::npos ? buffer.size() : end + 1;
+                    reader.feed(buffer.substr(done, end - done));
+                    done = end;
+                    report_progress(ini_parse_stage::tokenize, done, buffer.size());
+                }
+            }
+        }
+
+        throw_first_diagnostic();
+        ini_stage_timer timer(counters, ini_parse_stage::insert);
+        data.finalize();
+    }
+    else
+    {
+        // Делим буфер на равные диапазоны и в каждом ищем первую строку-заголовок
+        // секции; заодно считаем переводы строк, чтобы знать номера строк фрагментов
+        std::optional<ini_stage_timer> timer(std::in_place, counters, ini_parse_stage::tokenize);
+        size_t ranges = std::min<size_t>(threads * 4, buffer.size() / parallel_parse_min_chunk + 1);
+        std::vector<size_t> starts(ranges), lines_before(ranges), lines_total(ranges);
+
+        pool->parallel_for(ranges, [&](size_t i)
+        {
+            size_t begin = buffer.size() * i / ranges;
+            size_t end = buffer.size() * (i + 1) / ranges;
+            starts[i] = find_section_start(buffer, begin, end, lines_before[i]);
+            lines_total[i] = static_cast<size_t>(std::count(buffer.begin() + begin, buffer.begin() + end, '\n'));
+        });
+
+        // Фрагменты начинаются с найденных заголовков; первый - с начала файла
+        std::vector<size_t> chunk_begin{ 0 };
+        std::vector<int> chunk_line{ 1 };
+        size_t lines = 0;
+
+        for (size_t i = 0; i < ranges; ++i)
+        {
+            if (i != 0 && starts[i] != std::string_view::npos && starts[i] > chunk_begin.back())
+            {
+                chunk_begin.push_back(starts[i]);
+                chunk_line.push_back(static_cast<int>(lines + lines_before[i] + 1));
+            }
+            lines += lines_total[i];
+        }
+
+        chunk_begin.push_back(buffer.size());
+
+        // Каждый фрагмент разбирается в свое хранилище и упорядочивается там же
+        // (эта сортировка идет в потоках разбора и учитывается в его времени).
+        // Ошибки фрагментов склеиваются по порядку, поэтому первая из них -
+        // та же, что и при последовательном разборе
+        std::vector<ini_storage> parts(chunk_line.size());
+        std::vector<std::vector<ini_diagnostic>> part_diagnostics(parts.size());
+
+        pool->parallel_for(parts.size(), [&](size_t i)
+        {
+            parse_chunk(buffer.substr(chunk_begin[i], chunk_begin[i + 1] - chunk_begin[i]), chunk_line[i], parts[i],
+                part_diagnostics[i]);
+            parts[i].sort_pending();
+        });
+
+        for (const std::vector<ini_diagnostic>& part : part_diagnostics)
+        {
+            load_diagnostics.insert(load_diagnostics.end(), part.begin(), part.end());
+        }
+
+        throw_first_diagnostic();
+        report_progress(ini_parse_stage::tokenize, buffer.size(), buffer.size());
+        timer.emplace(counters, ini_parse_stage::insert);
+        data.finalize(parts, *pool);
+    }
+
+    // Новый набор записей - новый пустой кеш преобразованных значений
+    reset_value_cache();
+}
+
+// Конструктор парсера
+ini_parser::ini_parser(const std::string& filename, bool create_default)
+    : ini_parser(filename, ini_parser_options{ ini_load_mode::stream, create_default })
+{
+}
+
+// Пустой парсер: общая часть конструкторов
+ini_parser::ini_parser(const ini_parser_options& options)
+    : arena(options.use_arena && options.memory_resource == nullptr ? std::make_unique<std::pmr::monotonic_buffer_resource>() : nullptr),
+      resource(options.memory_resource != nullptr ? options.memory_resource : arena ? arena.get() : std::pmr::get_default_resource()),
+      data(resource), value_cache(resource), section_hashes(resource), arrays(std::make_unique<array_store>(resource)),
+      collect_errors(options.collect_errors), lazy(options.lazy && !options.collect_errors),
+      section_index(resource), lazy_sections(resource), parsed_sections(resource),
+      owned_buffer(resource), saved_text(resource), assigned_strings(resource),
+      use_default_config(false)
+{
+}
+
+// Конструктор парсера с параметрами загрузки
+ini_parser::ini_parser(const std::string& filename, const ini_parser_options& options)
+    : ini_parser(options)
+{
+    this->filename = filename;
+    sources.push_back({ filename, 0, 0 });
+
+    // Получатель хода нужен только при загрузке: materialize и копии не сообщают
+    load_progress = options.progress ? &options.progress : nullptr;
+    load_file(options);
+    load_progress = nullptr;
+}
+
+// Загрузка из снимка, отображения или потока; при отсутствии файла - встроенная конфигурация
+void ini_parser::load_file(const ini_parser_options& options)
+{
+    // Время изменения берется до чтения файла: если файл изменится во время
+    // чтения, снимок при следующей загрузке не совпадет с ним по времени
+    bool use_snapshot = !options.snapshot_file.empty();
+    int64_t source_mtime = 0;
+
+    if (use_snapshot)
+    {
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(filename, error);
+        use_snapshot = !error;
+        source_mtime = static_cast<int64_t>(time.time_since_epoch().count());
+
+        if (use_snapshot && load_snapshot(options.snapshot_file, source_mtime))
+        {
+            return;
+        }
+
+        // Для записи снимка нужен полный разбор
+        lazy = false;
+    }
+
+    if (options.load_mode == ini_load_mode::mapped)
+    {
+        // Отображаем файл в память и разбираем его на месте
+        bool mapped;
+
+        {
+            ini_stage_timer timer(counters, ini_parse_stage::read);
+            mapped = mapped_file.open(filename);
+        }
+
+        if (mapped)
+        {
+            report_progress(ini_parse_stage::read, mapped_file.view().size(), mapped_file.view().size());
+            parse_buffer(decode_text(mapped_file.view(), options.encoding), options.parse_threads);
+
+            // Перекодированный текст уже в собственном буфере
+            if (text_encoding != ini_encoding::utf8)
+            {
+                mapped_file = ini_mapped_file();
+            }
+
+            if (use_snapshot)
+            {
+                save_snapshot(options.snapshot_file, mapped_file.view(), source_mtime);
+            }
+            return;
+        }
+    }
+    else if (options.load_mode == ini_load_mode::read)
+    {
+        bool opened;
+
+        {
+            ini_stage_timer timer(counters, ini_parse_stage::read);
+            opened = ini_read_file(filename, owned_buffer);
+        }
+
+        if (opened)
+        {
+            std::string_view text(owned_buffer.data(), owned_buffer.size());
+            report_progress(ini_parse_stage::read, text.size(), text.size());
+            parse_buffer(decode_text(text, options.encoding), options.parse_threads);
+
+            if (use_snapshot)
+            {
+                save_snapshot(options.snapshot_file, text, source_mtime);
+            }
+            return;
+        }
+    }
+    else
+    {
+        // Пытаемся открыть файл; двоичный режим сохраняет байты UTF-16,
+        // а '\r' перед переводом строки отбрасывает сканер
+        std::ifstream file(filename, std::ios::binary);
+
+        if (file)
+        {
+            // Парсим существующий файл
+            parse_file(file, options.parse_threads, options.encoding);
+
+            if (use_snapshot)
+            {
+                save_snapshot(options.snapshot_file, std::string_view(owned_buffer.data(), owned_buffer.size()), source_mtime);
+            }
+            return;
+        }
+    }
+
+    // Если файл не найден и разрешено создание по умолчанию
+    if (!options.create_default)
+    {
+        throw ini_parser_error("Не удалось открыть файл: " + filename);
+    }
+
+    // Используем встроенную конфигурацию
+    use_default_config = true;
+    parse_buffer(default_config_text, 1);
+    create_default_config(filename);
+}
+
+// Копирование: хранилище и кеш копируются, а все строки собираются в один буфер,
+// поэтому копия не зависит от отображения файла и строк исходного парсера
+ini_parser::ini_parser(const ini_parser& other)
+    : arena(other.arena ? std::make_unique<std::pmr::monotonic_buffer_resource>() : nullptr),
+      resource(arena ? arena.get() : other.resource),
+      data(other.data, resource), value_cache(other.value_cache, resource), section_hashes(other.section_hashes, resource),
+      arrays(std::make_unique<array_store>(resource)),
+      collect_errors(other.collect_errors), load_diagnostics(other.load_diagnostics), lazy(other.lazy),
+      section_index(resource), lazy_sections(resource), parsed_sections(resource),
+      owned_buffer(other.lazy ? other.lazy_text.size() : data.string_bytes(), resource),
+      saved_text(resource), value_patches(other.value_patches), layout_changed(other.layout_changed),
+      is_frozen(other.is_frozen),
+      assigned_strings(resource),
+      filename(other.filename), sources(other.sources), use_default_config(other.use_default_config),
+      counters(other.counters)
+{
+    // Ленивый парсер копирует текст и заново строит индекс: разобранные
+    // секции исходного парсера в копии разбираются снова при обращении
+    if (lazy)
+    {
+        std::copy(other.lazy_text.begin(), other.lazy_text.end(), owned_buffer.begin());
+        build_lazy_index(std::string_view(owned_buffer.data(), owned_buffer.size()));
+        return;
+    }
+
+    data.relocate_strings(owned_buffer.data());
+
+    // Исходный текст нужен для сохранения с комментариями
+    if (!other.source_text.empty())
+    {
+        saved_text.assign(other.source_text.begin(), other.source_text.end());
+        source_text = std::string_view(saved_text.data(), saved_text.size());
+    }
+}
+
+// Потребитель событий многофайловой загрузки: записи всех файлов идут в одно
+// хранилище со сквозными номерами строк, "!include путь" разбирает файл на месте
+struct ini_parser::layer_builder : ini_event_visitor
+{
+    ini_parser& parser;
+    std::vector<std::string>& include_stack; // Канонические пути разбираемых файлов
+    uint32_t first_line;
+
+    layer_builder(ini_parser& parser, std::vector<std::string>& include_stack, uint32_t first_line)
+        : parser(parser), include_stack(include_stack), first_line(first_line)
+    {
+    }
+
+    void on_section(std::string_view name, int)
+    {
+        parser.data.add_section(name);
+    }
+
+    void on_key_value(std::string_view section, std::string_view key, std::string_view value, int line)
+    {
+        parser.data.add_value(section, key, value, first_line + static_cast<uint32_t>(line));
+    }
+
+    void on_directive(std::string_view text, int line)
+    {
+        size_t name_end = std::min(text.find_first_of(" \t"), text.size());
+
+        if (text.substr(0, name_end) != "include")
+        {
+            throw ini_parser_error("Неизвестная директива '!" + std::string(text.substr(0, name_end)) + "'", line);
+        }
+
+        size_t path_first = text.find_first_not_of(" \t", name_end);
+
+        if (path_first == std::string_view::npos)
+        {
+            throw ini_parser_error("Не указан файл в директиве !include", line);
+        }
+
+        // Относительный путь отсчитывается от каталога включающего файла
+        std::filesystem::path path(include_stack.back());
+        std::string target = (path.parent_path() / std::filesystem::path(text.substr(path_first))).string();
+        parser.load_layer(target, include_stack);
+    }
+};
+
+// Чтение файла в память парсера и разбор в общее хранилище
+void ini_parser::load_layer(const std::string& layer, std::vector<std::string>& include_stack)
+{
+    std::error_code error;
+    std::string canonical = std::filesystem::weakly_canonical(layer, error).string();
+
+    if (error)
+    {
+        canonical = layer;
+    }
+
+    if (std::find(include_stack.begin(), include_stack.end(), canonical) != include_stack.end())
+    {
+        throw ini_parser_error("Циклическое включение файла: " + layer);
+    }
+
+    std::ifstream file(layer, std::ios::binary);
+
+    if (!file)
+    {
+        throw ini_parser_error("Не удалось открыть файл: " + layer);
+    }
+
+    // Размер известен заранее; кодировка каждого файла определяется отдельно
+    std::pmr::string& raw = assigned_strings.emplace_back();
+    std::string_view text;
+
+    try
+    {
+        ini_stage_timer timer(counters, ini_parse_stage::read);
+        file.seekg(0, std::ios::end);
+        raw.resize(static_cast<size_t>(std::max<std::streamoff>(file.tellg(), 0)));
+        file.seekg(0);
+        file.read(raw.data(), static_cast<std::streamsize>(raw.size()));
+        raw.resize(static_cast<size_t>(file.gcount()));
+
+        std::pmr::vector<char> converted(resource);
+        ini_encoding detected;
+        text = decode_to_utf8(raw, ini_encoding::auto_detect, converted, detected);
+
+        if (detected != ini_encoding::utf8)
+        {
+            raw.assign(converted.begin(), converted.end());
+            text = raw;
+        }
+    }
+    catch (const ini_parser_error& e)
+    {
+        throw ini_parser_error("Файл '" + layer + "': " + e.what());
+    }
+
+    counters.add_text(text);
+
+    // Номера строк файла следуют за номерами всех ранее открытых файлов
+    uint32_t first_line = sources.empty() ? 0 : sources.back().first_line + sources.back().line_count;
+    uint32_t line_count = static_cast<uint32_t>(std::count(text.begin(), text.end(), '\n') + 1);
+    sources.push_back({ layer, first_line, line_count });
+
+    include_stack.push_back(canonical);
+    layer_builder builder(*this, include_stack, first_line);
+    ini_event_reader<layer_builder> reader(builder);
+
+    try
+    {
+        // Разбор включаемых файлов идет внутри feed и входит и в это время
+        ini_stage_timer timer(counters, ini_parse_stage::tokenize);
+        reader.feed(text);
+    }
+    catch (const ini_parser_error& e)
+    {
+        throw ini_parser_error("Файл '" + layer + "': " + e.what());
+    }
+
+    include_stack.pop_back();
+}
+
+// Конструктор выполняется задачей пула; packaged_task переносит в future
+// и результат, и исключение
+std::future<std::unique_ptr<ini_parser>> ini_parser::load_async(const std::string& filename, const ini_parser_options& options)
+{
+    auto task = std::make_shared<std::packaged_task<std::unique_ptr<ini_parser>()>>([filename, options]
+    {
+        return std::make_unique<ini_parser>(filename, options);
+    });
+
+    std::future<std::unique_ptr<ini_parser>> result = task->get_future();
+    ini_thread_pool::shared().submit([task]
+    {
+        (*task)();
+    });
+    return result;
+}
+
+// Текст в UTF-8 копируется в собственный буфер и разбирается как содержимое файла
+ini_parser ini_parser::from_text(std::string_view text, const ini_parser_options& options)
+{
+    ini_parser parser(options);
+    parser.sources.push_back({ {}, 0, 0 });
+    parser.load_progress = options.progress ? &options.progress : nullptr;
+
+    {
+        // Текст не в UTF-8 перекодируется сразу в буфер парсера, без копии исходного
+        ini_stage_timer timer(parser.counters, ini_parse_stage::read);
+        std::pmr::vector<char> converted(parser.resource);
+        std::string_view decoded = decode_to_utf8(text, options.encoding, converted, parser.text_encoding);
+
+        if (parser.text_encoding == ini_encoding::utf8)
+        {
+            parser.owned_buffer.assign(decoded.begin(), decoded.end());
+        }
+        else
+        {
+            parser.owned_buffer.swap(converted);
+        }
+    }
+
+    parser.parse_buffer(std::string_view(parser.owned_buffer.data(), parser.owned_buffer.size()), options.parse_threads);
+    parser.load_progress = nullptr;
+    return parser;
+}
+
+// При известном размере буфер выделяется один раз и растет, только если
+// источник дал больше байт, чем обещал. Без размера текст в UTF-8 разбирается
+// по блокам, а остальной собирается в буфер, начиная с уже прочитанного блока
+ini_parser ini_parser::from_chunks(ini_chunk_reader& reader, const ini_parser_options& options)
+{
+    ini_parser parser(options);
+    parser.sources.push_back({ {}, 0, 0 });
+    parser.load_progress = options.progress ? &options.progress : nullptr;
+    size_t expected = reader.size_hint();
+    std::pmr::vector<char>& buffer = parser.owned_buffer;
+    size_t used = 0;
+
+    if (expected == 0)
+    {
+        parser.lazy = false;
+
+        if ((options.encoding == ini_encoding::auto_detect || options.encoding == ini_encoding::utf8) &&
+            parser.parse_chunks(reader, options.encoding))
+        {
+            parser.load_progress = nullptr;
+            return parser;
+        }
+
+        used = buffer.size();
+    }
+
+    {
+        // Лишний байт позволяет увидеть конец данных, не увеличивая буфер
+        ini_stage_timer timer(parser.counters, ini_parse_stage::read);
+        buffer.resize(expected == 0 ? std::max(used * 2, chunk_block_size) : expected + 1);
+
+        for (;;)
+        {
+            if (used == buffer.size())
+            {
+                buffer.resize(buffer.size() * 2);
+            }
+
+            size_t count = reader.read(buffer.data() + used, buffer.size() - used);
+
+            if (count == 0)
+            {
+                break;
+            }
+
+            used += count;
+            parser.report_progress(ini_parse_stage::read, used, std::max(expected, used));
+        }
+
+        buffer.resize(used);
+    }
+
+    parser.parse_buffer(parser.decode_text(std::string_view(buffer.data(), buffer.size()), options.encoding), options.parse_threads);
+    parser.load_progress = nullptr;
+    return parser;
+}
+
+// Каждый блок читается в новую строку assigned_strings, которая не перемещается,
+// поэтому записи указывают прямо в блоки. Незаконченная строка в конце блока
+// переносится в начало следующего; строка длиннее блока увеличивает его
+// до того, как на него появятся ссылки. Блоки заканчиваются переводом строки,
+// поэтому каждый проверяется как UTF-8 отдельно. false - первый блок показал,
+// что текст не в UTF-8: он переносится в owned_buffer неразобранным
+bool ini_parser::parse_chunks(ini_chunk_reader& reader, ini_encoding encoding)
+{
+    source_text = {};
+    value_patches.clear();
+    layout_changed = false;
+    load_diagnostics.clear();
+
+    ini_storage_builder builder(data, load_diagnostics);
+    ini_event_reader<ini_storage_builder> events(builder);
+    std::pmr::string* previous = nullptr;
+    size_t carried = 0;
+    uint64_t total = 0;
+
+    for (bool finished = false; !finished;)
+    {
+        std::pmr::string& block = assigned_strings.emplace_back();
+        block.resize(std::max(chunk_block_size, carried * 2));
+        size_t used = carried;
+
+        if (previous != nullptr)
+        {
+            std::memcpy(block.data(), previous->data() + previous->size() - carried, carried);
+            previous->resize(previous->size() - carried);
+        }
+
+        size_t complete = 0;
+
+        while (complete == 0 && !finished)
+        {
+            {
+                ini_stage_timer timer(counters, ini_parse_stage::read);
+
+                while (used < block.size())
+                {
+                    size_t count = reader.read(block.data() + used, block.size() - used);
+
+                    if (count == 0)
+                    {
+                        finished = true;
+                        break;
+                    }
+
+                    used += count;
+                }
+            }
+
+            size_t last_newline = std::string_view(block.data(), used).rfind('\n');
+            complete = finished ? used : last_newline == std::string_view::npos ? 0 : last_newline + 1;
+
+            if (complete == 0 && !finished)
+            {
+                block.resize(block.size() * 2);
+            }
+        }
+
+        block.resize(used);
+        std::string_view text(block.data(), complete);
+
+        if (previous == nullptr)
+        {
+            size_t bom_size;
+            ini_encoding bom = ini_detect_bom(text, bom_size);
+            bool utf8 = bom == ini_encoding::utf8 || (bom == ini_encoding::auto_detect &&
+                (encoding == ini_encoding::utf8 || ini_find_invalid_utf8(text) == std::string_view::npos));
+
+            if (!utf8)
+            {
+                owned_buffer.assign(block.begin(), block.end());
+                assigned_strings.pop_back();
+                return false;
+            }
+
+            text.remove_prefix(bom_size);
+        }
+
+        if (size_t error = ini_find_invalid_utf8(text); error != std::string_view::npos)
+        {
+            throw ini_parser_error("Некорректный текст в кодировке utf-8",
+                events.line() + static_cast<int>(std::count(text.begin(), text.begin() + error, '\n')) + 1);
+        }
+
+        counters.add_text(text);
+        total += complete;
+
+        {
+            ini_stage_timer timer(counters, ini_parse_stage::tokenize);
+            events.feed(text);
+        }
+
+        report_progress(ini_parse_stage::tokenize, total, std::max<uint64_t>(reader.size_hint(), total));
+        carried = used - complete;
+        previous = &block;
+    }
+
+    throw_first_diagnostic();
+
+    {
+        ini_stage_timer timer(counters, ini_parse_stage::insert);
+        data.finalize();
+    }
+
+    reset_value_cache();
+    return true;
+}
+
+// Все слои разбираются в накопленные данные одного хранилища, и только затем
+// строится индекс: устойчивая сортировка оставляет последнее значение ключа.
+// Файл для save() не задается: объединение слоев не должно заменять ни один из них
+ini_parser ini_parser::load_layers(const std::vector<std::string>& layers, const ini_parser_options& options)
+{
+    ini_parser parser(options);
+    parser.lazy = false;
+    std::vector<std::string> include_stack;
+
+    for (const std::string& layer : layers)
+    {
+        if (options.skip_missing_layers && !std::filesystem::exists(layer))
+        {
+            continue;
+        }
+
+        parser.load_layer(layer, include_stack);
+    }
+
+    {
+        ini_stage_timer timer(parser.counters, ini_parse_stage::insert);
+        parser.data.finalize();
+    }
+
+    parser.reset_value_cache();
+    return parser;
+}
+
+// Загрузка из снимка, если он построен по текущему содержимому файла
+bool ini_parser::load_snapshot(const std::string& snapshot_file, int64_t source_mtime)
+{
+    ini_stage_timer timer(counters, ini_parse_stage::read);
+    ini_mapped_file snapshot;
+    ini_snapshot_source recorded;
+
+    if (!snapshot.open(snapshot_file) || !ini_snapshot::read_source(snapshot.view(), recorded))
+    {
+        return false;
+    }
+
+    std::error_code error;
+    uintmax_t source_size = std::filesystem::file_size(filename, error);
+
+    if (error || source_size != recorded.size)
+    {
+        return false;
+    }
+
+    // Время изменения меняется и без изменения содержимого (копирование, checkout),
+    // тогда снимок годен, если совпадает хеш текста
+    if (source_mtime != recorded.mtime)
+    {
+        ini_mapped_file source;
+
+        if (!source.open(filename) || ini_checksum(source.view().data(), source.view().size()) != recorded.hash)
+        {
+            return false;
+        }
+    }
+
+    if (!ini_snapshot::read(snapshot.view(), data))
+    {
+        data = ini_storage(resource);
+        return false;
+    }
+
+    // Строки хранилища указывают в отображение снимка
+    mapped_file = std::move(snapshot);
+    lazy = false;
+    reset_value_cache();
+    return true;
+}
+
+// Запись снимка после разбора текста; ошибка записи не мешает работе парсера.
+// Текст с ошибками (collect_errors) в снимок не попадает: загрузка из снимка
+// их бы уже не показала. Перекодированного исходного текста уже нет, и снимок
+// для него не пишется
+void ini_parser::save_snapshot(const std::string& snapshot_file, std::string_view text, int64_t source_mtime) const
+{
+    if (!load_diagnostics.empty() || text_encoding != ini_encoding::utf8)
+    {
+        return;
+    }
+
+    ini_snapshot_source source = { text.size(), source_mtime, ini_checksum(text.data(), text.size()) };
+    ini_snapshot::write(snapshot_file, data, source);
+}
+
+// Быстрый проход: индекс секций и пустые ячейки для их разбора
+void ini_parser::build_lazy_index(std::string_view buffer)
+{
+    ini_stage_timer timer(counters, ini_parse_stage::tokenize);
+    section_index.build(buffer);
+    lazy_text = buffer;
+    parsed_sections.clear();
+    arrays->pool.release();
+    lazy_sections.clear();
+    lazy_sections.resize(section_index.all_sections().size());
+    lazy_mutex = std::make_unique<std::mutex>();
+}
+
+// Разбор всех участков секции в ее собственное хранилище. Готовая секция
+// читается без блокировки; разбор идет под lazy_mutex, поэтому ресурс памяти
+// (в том числе непотокобезопасная арена) используется одним потоком
+const ini_parser::parsed_section& ini_parser::parse_lazy_section(uint32_t section) const
+{
+    lazy_section& slot = lazy_sections[section];
+    const parsed_section* parsed = slot.parsed.load(std::memory_order_acquire);
+
+    if (parsed != nullptr)
+    {
+        return *parsed;
+    }
+
+    std::lock_guard<std::mutex> lock(*lazy_mutex);
+    parsed = slot.parsed.load(std::memory_order_relaxed);
+
+    if (parsed != nullptr)
+    {
+        return *parsed;
+    }
+
+    parsed_section& result = parsed_sections.emplace_back(resource);
+    const ini_indexed_section& info = section_index.all_sections()[section];
+    std::vector<ini_diagnostic> diagnostics;
+
+    {
+        ini_stage_timer timer(counters, ini_parse_stage::tokenize);
+
+        for (uint32_t i = 0; i < info.range_count; ++i)
+        {
+            const ini_section_range& range = section_index.range(info.first_range + i);
+            parse_chunk(lazy_text.substr(range.offset, range.size), range.first_line, result.storage, diagnostics);
+        }
+    }
+
+    if (diagnostics.empty())
+    {
+        ini_stage_timer timer(counters, ini_parse_stage::insert);
+        result.storage.finalize();
+        result.cache.resize(result.storage.all_entries().size());
+    }
+    else
+    {
+        result.error = std::make_exception_ptr(diagnostics.front().to_error());
+    }
+
+    slot.parsed.store(&result, std::memory_order_release);
+    return result;
+}
+
+// Ленивый парсер перед изменением разбирается целиком; при ошибке разбора
+// парсер остается ленивым
+void ini_parser::materialize()
+{
+    lazy = false;
+
+    try
+    {
+        parse_buffer(lazy_text, 1);
+    }
+    catch (...)
+    {
+        lazy = true;
+        data = ini_storage(resource);
+        throw;
+    }
+
+    section_index.clear();
+    parsed_sections.clear();
+    lazy_sections.clear();
+    lazy_sections.shrink_to_fit();
+    lazy_mutex.reset();
+}
+
+// Поиск записи по ключу без исключений с учетом в статистике
+bool ini_parser::lookup(std::string_view key_path, entry_ref& ref) const
+{
+    bool found = find_ref(key_path, ref);
+
+#if INI_PARSER_STATS
+    if (found)
+    {
+        ref.cache->counters.count_path_lookup();
+    }
+    else
+    {
+        counters.count_miss();
+    }
+#endif
+
+    return found;
+}
+
+// Поиск записи по ключу без исключений (false, если путь некорректен, ключ не найден
+// или секция ленивого режима содержит ошибку)
+bool ini_parser::find_ref(std::string_view key_path, entry_ref& ref) const
+{
+    size_t dot_pos = key_path.find('.');
+
+    if (dot_pos == std::string_view::npos || dot_pos == 0 || dot_pos + 1 == key_path.size())
+    {
+        return false;
+    }
+
+    std::string_view section = key_path.substr(0, dot_pos);
+    std::string_view key = key_path.substr(dot_pos + 1);
+    uint64_t hash = ini_hash(key_path);
+
+    if (!lazy)
+    {
+        const ini_entry* entry = data.find(section, key, hash);
+
+        if (entry == nullptr)
+        {
+            return false;
+        }
+
+        ref = { entry, &value_cache[entry_index(*entry)], 0 };
+        return true;
+    }
+
+    // Ленивый режим: секция разбирается при первом обращении
+    const ini_indexed_section* info = section_index.find(section);
+
+    if (info == nullptr)
+    {
+        return false;
+    }
+
+    uint32_t section_number = static_cast<uint32_t>(info - section_index.all_sections().data());
+    const parsed_section& parsed = parse_lazy_section(section_number);
+
+    if (parsed.error)
+    {
+        return false;
+    }
+
+    const ini_entry* entry = parsed.storage.find(section, key, hash);
+
+    if (entry == nullptr)
+    {
+        return false;
+    }
+
+    ref = { entry, &parsed.cache[entry - parsed.storage.all_entries().data()], section_number + 1 };
+    return true;
+}
+
+// Расстояние редактирования без учета регистра латиницы, если оно не больше limit;
+// иначе limit + 1. Строки длиннее similar_name_max_size не сравниваются
+static const size_t similar_name_max_size = 64;
+
+static size_t bounded_edit_distance(std::string_view a, std::string_view b, size_t limit)
+{
+    size_t length_difference = a.size() > b.size() ? a.size() - b.size() : b.size() - a.size();
+
+    if (length_difference > limit || a.size() > similar_name_max_size || b.size() > similar_name_max_size)
+    {
+        return limit + 1;
+    }
+
+    auto lower = [](char c)
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    };
+
+    size_t previous[similar_name_max_size + 1];
+    size_t current[similar_name_max_size + 1];
+
+    for (size_t j = 0; j <= b.size(); ++j)
+    {
+        previous[j] = j;
+    }
+
+    for (size_t i = 1; i <= a.size(); ++i)
+    {
+        current[0] = i;
+        size_t row_min = i;
+
+        for (size_t j = 1; j <= b.size(); ++j)
+        {
+            size_t substitution = previous[j - 1] + (lower(a[i - 1]) == lower(b[j - 1]) ? 0 : 1);
+            current[j] = std::min({ previous[j] + 1, current[j - 1] + 1, substitution });
+            row_min = std::min(row_min, current[j]);
+        }
+
+        // Вся строка таблицы больше предела - дальше расстояние только растет
+        if (row_min > limit)
+        {
+            return limit + 1;
+        }
+
+        std::copy(current, current + b.size() + 1, previous);
+    }
+
+    return previous[b.size()];
+}
+
+// Подсказка "возможно, имелось в виду" из нескольких самых похожих имен.
+// Имена перебираются без выделения памяти, строка собирается только из
+// найденных, поэтому стоимость промаха не зависит от длины имен всех секций
+template<typename NameAt>
+static std::string similar_names_hint(std::string_view name, size_t count, NameAt name_at, const char* what)
+{
+    const size_t max_hints = 3;
+    const size_t limit = std::max<size_t>(1, name.size() / 3);
+    std::string_view best[max_hints];
+    size_t best_distance[max_hints];
+    size_t found = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string_view candidate = name_at(i);
+        size_t distance = bounded_edit_distance(name, candidate, limit);
+
+        if (distance > limit || (found == max_hints && distance >= best_distance[found - 1]))
+        {
+            continue;
+        }
+
+        // Вставка в упорядоченный по расстоянию список лучших
+        size_t pos = found < max_hints ? found++ : found - 1;
+
+        while (pos > 0 && best_distance[pos - 1] > distance)
+        {
+            best[pos] = best[pos - 1];
+            best_distance[pos] = best_distance[pos - 1];
+            pos--;
+        }
+
+        best[pos] = candidate;
+        best_distance[pos] = distance;
+    }
+
+    if (found == 0)
+    {
+        return std::string(what) + ": " + std::to_string(count);
+    }
+
+    std::string hint = "Возможно, имелось в виду: ";
+
+    for (size_t i = 0; i < found; ++i)
+    {
+        if (i != 0)
+        {
+            hint += ", ";
+        }
+        hint += best[i];
+    }
+
+    return hint;
+}
+
+// Поиск записи по ключу; при отсутствии подсказывает похожие имена
+ini_parser::entry_ref ini_parser::find_entry(std::string_view key_path) const
+{
+    // Основной путь - поиск без исключений
+    entry_ref ref;
+
+    if (lookup(key_path, ref))
+    {
+        return ref;
+    }
+
+    // Разделяем путь на секцию и ключ
+    size_t dot_pos = key_path.find('.');
+
+    if (dot_pos == std::string_view::npos)
+    {
+        throw ini_parser_error("Некорректный формат ключа (отсутствует '.')");
+    }
+
+    std::string_view section = key_path.substr(0, dot_pos);
+    std::string_view key = key_path.substr(dot_pos + 1);
+
+    // Проверяем что секция и ключ не пустые
+    if (section.empty() || key.empty())
+    {
+        throw ini_parser_error("Пустое имя секции или ключа");
+    }
+
+    // Секция (ее отсутствие и ошибки разбора выбрасывает get_section), а в ней нет ключа
+    section_view keys = get_section(section);
+    throw ini_parser_error("Ключ '" + std::string(key) + "' не найден в секции '" + std::string(section) + "'. " +
+        similar_names_hint(key, keys.size(), [&](size_t i) { return keys.first[i].key; }, "Всего ключей в секции"));
+}
+
+// Представление найденной секции хранилища storage (общего или разобранной
+// ленивой секции parsed с номером lazy_section + 1)
+ini_parser::section_view ini_parser::make_section_view(const ini_storage& storage, const ini_section& section,
+    const parsed_section* parsed, uint32_t lazy_section) const
+{
+    section_view view;
+    view.parser = this;
+    view.section_name = section.name;
+    view.first = storage.all_entries().data() + section.first_entry;
+    view.first_index = section.first_entry;
+    view.count = section.entry_count;
+    view.lazy_section = lazy_section;
+    view.hash_slot = parsed != nullptr ? &parsed->hash : &section_hashes[static_cast<size_t>(&section - data.all_sections().data())].hash;
+    return view;
+}
+
+// Поиск секции: в ленивом режиме - в индексе, а ошибки ее разбора выбрасываются здесь
+bool ini_parser::find_section_view(std::string_view name, section_view& view) const
+{
+    const ini_storage* storage = &data;
+    const parsed_section* parsed = nullptr;
+    uint32_t lazy_section = 0;
+
+    if (lazy)
+    {
+        const ini_indexed_section* info = section_index.find(name);
+
+        if (info == nullptr)
+        {
+            return false;
+        }
+
+        lazy_section = static_cast<uint32_t>(info - section_index.all_sections().data());
+        parsed = &parse_lazy_section(lazy_section++);
+
+        if (parsed->error)
+        {
+            std::rethrow_exception(parsed->error);
+        }
+
+        storage = &parsed->storage;
+    }
+
+    const ini_section* section = storage->find_section(name);
+
+    if (section == nullptr)
+    {
+        return false;
+    }
+
+    view = make_section_view(*storage, *section, parsed, lazy_section);
+    return true;
+}
+
+ini_parser::section_view ini_parser::get_section(std::string_view name) const
+{
+    section_view view;
+
+    if (!find_section_view(name, view))
+    {
+        if (lazy)
+        {
+            const auto& sections = section_index.all_sections();
+            throw ini_parser_error("Секция '" + std::string(name) + "' не найдена. " +
+                similar_names_hint(name, sections.size(), [&](size_t i) { return sections[i].name; }, "Всего секций"));
+        }
+
+        const auto& sections = data.all_sections();
+        throw ini_parser_error("Секция '" + std::string(name) + "' не найдена. " +
+            similar_names_hint(name, sections.size(), [&](size_t i) { return sections[i].name; }, "Всего секций"));
+    }
+
+    return view;
+}
+
+std::optional<ini_parser::section_view> ini_parser::find_section(std::string_view name) const
+{
+    section_view view;
+
+    if (!find_section_view(name, view))
+    {
+        return std::nullopt;
+    }
+
+    return view;
+}
+
+// Секции перечисляются по массиву хранилища, без поиска по имени
+std::vector<ini_parser::section_view> ini_parser::sections() const
+{
+    std::vector<section_view> result;
+
+    if (!lazy)
+    {
+        result.reserve(data.all_sections().size());
+
+        for (const ini_section& section : data.all_sections())
+        {
+            result.push_back(make_section_view(data, section, nullptr, 0));
+        }
+
+        return result;
+    }
+
+    const auto& indexed = section_index.all_sections();
+    result.reserve(indexed.size());
+
+    for (uint32_t i = 0; i < indexed.size(); ++i)
+    {
+        const parsed_section& parsed = parse_lazy_section(i);
+
+        if (parsed.error)
+        {
+            std::rethrow_exception(parsed.error);
+        }
+
+        const ini_section* section = parsed.storage.find_section(indexed[i].name);
+
+        if (section != nullptr)
+        {
+            result.push_back(make_section_view(parsed.storage, *section, &parsed, i + 1));
+        }
+    }
+
+    return result;
+}
+
+// Перемешивание слова текста с хешем
+static uint64_t content_mix(uint64_t hash, uint64_t word)
+{
+    hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 32);
+}
+
+// Текст словами по 8 байт. Остаток читается двумя перекрывающимися словами по
+// 4 байта или тремя байтами (длина уже учтена в хеше записи), без memcpy
+// переменной длины
+static uint64_t content_hash_append(uint64_t hash, std::string_view text)
+{
+    const char* pos = text.data();
+    size_t size = text.size();
+
+    for (; size >= 8; pos += 8, size -= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, pos, 8);
+        hash = content_mix(hash, word);
+    }
+
+    if (size >= 4)
+    {
+        uint32_t low;
+        uint32_t high;
+        std::memcpy(&low, pos, 4);
+        std::memcpy(&high, pos + size - 4, 4);
+        hash = content_mix(hash, static_cast<uint64_t>(high) << 32 | low);
+    }
+    else if (size != 0)
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(pos);
+        hash = content_mix(hash, static_cast<uint64_t>(bytes[0]) << 16 | static_cast<uint64_t>(bytes[size / 2]) << 8 | bytes[size - 1]);
+    }
+
+    return hash;
+}
+
+// Хеш содержимого - сумма хешей записей. Хеш записи начинается с длин ключа и
+// значения, поэтому границы между строками не дают разным записям совпасть.
+// Хеши записей не зависят друг от друга и вычисляются процессором параллельно,
+// а порядок записей в секции задан ключами. Не криптографический: для
+// обнаружения изменений, а не для защиты от подобранных коллизий.
+// 0 означает "еще не вычислен"
+uint64_t ini_parser::section_view::content_hash() const
+{
+    uint64_t hash = hash_slot != nullptr ? hash_slot->load(std::memory_order_relaxed) : 0;
+
+    if (hash != 0)
+    {
+        return hash;
+    }
+
+    hash = content_mix(0, count);
+
+    for (const ini_entry* entry = first; entry != first + count; ++entry)
+    {
+        uint64_t entry_hash = content_mix(0, static_cast<uint64_t>(entry->key.size()) << 32 | entry->value.size());
+        hash += content_hash_append(content_hash_append(entry_hash, entry->key), entry->value);
+    }
+
+    hash = hash != 0 ? hash : 1;
+
+    // Записи секции не меняются, пока ее читают, поэтому параллельные вызовы
+    // вычисляют одно и то же значение
+    if (hash_slot != nullptr)
+    {
+        hash_slot->store(hash, std::memory_order_relaxed);
+    }
+
+    return hash;
+}
+
+// Статистика: размеры и память считаются по текущему состоянию, счетчики
+// ключей собираются из кешей общего хранилища или разобранных ленивых секций
+ini_stats ini_parser::stats() const
+{
+    ini_stats result;
+    counters.fill(result);
+
+    auto add_storage = [&](const ini_storage& storage, const std::pmr::vector<typed_cache>& cache)
+    {
+        result.keys += storage.all_entries().size();
+        result.storage_bytes += storage.memory_bytes();
+        result.cache_bytes += cache.capacity() * sizeof(typed_cache);
+
+#if INI_PARSER_STATS
+        const auto& entries = storage.all_entries();
+
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            if (cache[i].counters.used())
+            {
+                std::string key(storage.all_sections()[entries[i].section].name);
+                key += '.';
+                key += entries[i].key;
+                result.hot_keys.push_back(cache[i].counters.get(std::move(key)));
+            }
+        }
+#endif
+    };
+
+    if (lazy)
+    {
+        result.sections = section_index.all_sections().size();
+        result.storage_bytes += section_index.memory_bytes();
+
+        for (const lazy_section& slot : lazy_sections)
+        {
+            if (const parsed_section* parsed = slot.parsed.load(std::memory_order_acquire))
+            {
+                add_storage(parsed->storage, parsed->cache);
+            }
+        }
+    }
+    else
+    {
+        result.sections = data.all_sections().size();
+        add_storage(data, value_cache);
+        result.cache_bytes += section_hashes.capacity() * sizeof(section_hash_slot);
+    }
 
-// Удаление пробелов в начале и конце строки
-std::string ini_parser::trim(const std::string& str)
-{
-    // Находим первый непробельный символ
-    size_t first = str.find_first_not_of(" \t");
+    result.text_bytes = owned_buffer.capacity() + saved_text.capacity();
 
-    // Если строка состоит только из пробелов
-    if (first == std::string::npos)
+    for (const std::pmr::string& text : assigned_strings)
     {
-        return "";
+        result.text_bytes += text.capacity();
     }
 
-    // Находим последний непробельный символ
-    size_t last = str.find_last_not_of(" \t");
-    return str.substr(first, (last - first + 1));
+    std::sort(result.hot_keys.begin(), result.hot_keys.end(), [](const ini_key_stats& a, const ini_key_stats& b)
+    {
+        uint64_t a_total = a.reads + a.path_lookups;
+        uint64_t b_total = b.reads + b.path_lookups;
+        return a_total != b_total ? a_total > b_total : a.key < b.key;
+    });
+
+    return result;
 }
 
-// Разделение строки на ключ и значение
-std::pair<std::string, std::string> ini_parser::split_key_value(const std::string& line, int line_num)
+// Получение строкового значения по ключу
+std::string_view ini_parser::get_value_as_string(std::string_view key_path) const
 {
-    // Ищем позицию знака равенства
-    size_t eq_pos = line.find('=');
-
-    // Если знак равенства не найден
-    if (eq_pos == std::string::npos)
-    {
-        throw ini_parser_error("Некорректный формат строки (отсутствует '=')", line_num);
-    }
-
-    // Извлекаем и тримим ключ
-    std::string key = trim(line.substr(0, eq_pos));
+    return find_entry(key_path).entry->value;
+}
 
-    // Проверяем что ключ не пустой
-    if (key.empty())
+// Дескриптор найденной записи
+ini_parser::key_handle ini_parser::make_handle(const entry_ref& ref) const
+{
+    if (ref.lazy_section == 0)
     {
-        throw ini_parser_error("Пустой ключ", line_num);
+        return key_handle{ entry_index(*ref.entry), 0 };
     }
 
-    // Извлекаем и тримим значение
-    std::string value = trim(line.substr(eq_pos + 1));
-    return std::make_pair(key, value);
+    const parsed_section& parsed = *lazy_sections[ref.lazy_section - 1].parsed.load(std::memory_order_acquire);
+    return key_handle{ static_cast<uint32_t>(ref.entry - parsed.storage.all_entries().data()), ref.lazy_section };
 }
 
-// Проверка корректности имени секции
-void ini_parser::validate_section_name(const std::string& name, int line_num)
+// Файл записи - последний из файлов, чьи номера строк начинаются раньше ее строки
+ini_value_origin ini_parser::entry_origin(const ini_entry& entry) const
 {
-    // Имя секции не может быть пустым
-    if (name.empty())
+    if (entry.line == 0 || sources.empty())
     {
-        throw ini_parser_error("Пустое имя секции", line_num);
+        return { {}, 0 };
     }
 
-    // Имя секции не должно содержать пробелов
-    for (char c : name)
-    {
-        if (std::isspace(c))
+    auto it = std::partition_point(sources.begin(), sources.end(),
+        [&entry](const source_file& source)
         {
-            throw ini_parser_error("Имя секции содержит пробелы", line_num);
-        }
-    }
+            return source.first_line < entry.line;
+        });
+
+    const source_file& source = *(it - 1);
+    return { source.name, static_cast<int>(entry.line - source.first_line) };
 }
 
-// Проверка корректности имени ключа
-void ini_parser::validate_key_name(const std::string& name, int line_num)
+std::optional<ini_value_origin> ini_parser::origin(std::string_view key_path) const
 {
-    // Ключ не может быть пустым
-    if (name.empty())
-    {
-        throw ini_parser_error("Пустой ключ", line_num);
-    }
+    entry_ref ref;
 
-    // Ключ не должен содержать пробелов
-    for (char c : name)
+    if (!find_ref(key_path, ref))
     {
-        if (std::isspace(c))
-        {
-            throw ini_parser_error("Ключ содержит пробелы", line_num);
-        }
+        return std::nullopt;
     }
+
+    return entry_origin(*ref.entry);
+}
+
+bool ini_parser::contains(std::string_view key_path) const
+{
+    entry_ref ref;
+    return lookup(key_path, ref);
 }
 
-// Основной метод парсинга INI-файла
-void ini_parser::parse_file(std::istream& stream)
+std::optional<ini_parser::key_handle> ini_parser::find(std::string_view key_path) const
 {
-    std::string current_section;
-    std::string line;
-    int line_num = 0;
+    entry_ref ref;
 
-    // Читаем файл построчно
-    while (std::getline(stream, line))
+    if (!lookup(key_path, ref))
     {
-        line_num++;
-        line = trim(line);
-
-        // Пропускаем пустые строки и комментарии
-        if (line.empty() || line[0] == ';')
-        {
-            continue;
-        }
+        return std::nullopt;
+    }
 
-        // Обработка секции
-        if (line[0] == '[')
-        {
-            // Проверяем что секция закрыта
-            if (line.back() != ']')
-            {
-                throw ini_parser_error("Некорректное объявление секции - отсутствует ']'", line_num);
-            }
+    return make_handle(ref);
+}
 
-            // Извлекаем имя секции
-            current_section = trim(line.substr(1, line.size() - 2));
-            validate_section_name(current_section, line_num);
+// Разрешение пути в дескриптор записи
+ini_parser::key_handle ini_parser::resolve(std::string_view key_path) const
+{
+    return make_handle(find_entry(key_path));
+}
 
-            // Добавляем секцию в данные
-            data[current_section];
-            continue;
-        }
+// Копия строки в памяти парсера
+std::string_view ini_parser::store_string(std::string_view str)
+{
+    return assigned_strings.emplace_back(str);
+}
 
-        // Проверяем что ключ-значение находится внутри секции
-        if (current_section.empty())
-        {
-            throw ini_parser_error("Ключ-значение вне секции", line_num);
-        }
+// Если хеши двух путей совпадут, хранилище сохранит обычный индекс,
+// но парсер все равно становится неизменяемым
+void ini_parser::freeze()
+{
+    if (lazy)
+    {
+        materialize();
+    }
 
-        // Разделяем ключ и значение
-        auto kv_pair = split_key_value(line, line_num);
-        validate_key_name(kv_pair.first, line_num);
+    data.freeze();
+    is_frozen = true;
+}
 
-        // Сохраняем значение
-        data[current_section][kv_pair.first] = kv_pair.second;
+void ini_parser::check_not_frozen() const
+{
+    if (is_frozen)
+    {
+        throw ini_parser_error("Конфигурация заморожена (freeze): изменение невозможно");
     }
 }
 
-// Конструктор парсера
-ini_parser::ini_parser(const std::string& filename, bool create_default)
-    : filename(filename), use_default_config(false)
+// Путь и значение для записи: те же проверки имен, что и при разборе файла
+void ini_parser::split_assignment(std::string_view key_path, std::string_view value, std::string_view& section,
+    std::string_view& key)
 {
-    // Пытаемся открыть файл
-    std::ifstream file(filename);
+    size_t dot_pos = key_path.find('.');
 
-    if (!file)
+    if (dot_pos == std::string_view::npos)
     {
-        // Если файл не найден и разрешено создание по умолчанию
-        if (create_default)
-        {
-            // Используем встроенную конфигурацию
-            std::istringstream default_config(R"(
-[Section1]
-; Пример секции с русскими комментариями
-var1 = 5
-var2 = Привет, мир!
-
-[Section2]
-var1 = 42
-var2 = Тестовая строка
-)");
-            use_default_config = true;
-            parse_file(default_config);
-            create_default_config(filename);
-        }
-        else
-        {
-            throw ini_parser_error("Не удалось открыть файл: " + filename);
-        }
+        throw ini_parser_error("Некорректный формат ключа (отсутствует '.')");
     }
-    else
+
+    section = key_path.substr(0, dot_pos);
+    key = key_path.substr(dot_pos + 1);
+
+    validate_section_name(section, ini_has_space(section), -1);
+    validate_key_name(key, ini_has_space(key), -1);
+
+    if (value.find_first_of("\r\n") != std::string_view::npos)
     {
-        // Парсим существующий файл
-        parse_file(file);
+        throw ini_parser_error("Значение содержит перевод строки");
     }
 }
 
-// Получение строкового значения по ключу
-std::string ini_parser::get_value_as_string(const std::string& key_path)
+// Новое значение существующей записи: записи не сдвигаются, сбрасываются
+// только кеш этой записи и хеш ее секции
+void ini_parser::assign_entry(const ini_entry& entry, std::string_view value)
 {
-    // Разделяем путь на секцию и ключ
-    size_t dot_pos = key_path.find('.');
+    uint32_t index = entry_index(entry);
+    record_value_patch(index);
+    data.set_entry_value(index, store_string(value));
+    value_cache[index].valid.store(0, std::memory_order_relaxed);
+    release_arrays(value_cache[index]);
+    section_hashes[entry.section].hash.store(0, std::memory_order_relaxed);
+}
+
+// Установка значения с теми же проверками имен, что и при разборе файла
+void ini_parser::set_value(std::string_view key_path, std::string_view value)
+{
+    check_not_frozen();
+
+    std::string_view section;
+    std::string_view key;
+    split_assignment(key_path, value, section, key);
 
-    if (dot_pos == std::string::npos)
+    if (lazy)
     {
-        throw ini_parser_error("Некорректный формат ключа (отсутствует '.')");
+        materialize();
     }
 
-    std::string section = key_path.substr(0, dot_pos);
-    std::string key = key_path.substr(dot_pos + 1);
+    const ini_entry* entry = data.find(section, key);
 
-    // Проверяем что секция и ключ не пустые
-    if (section.empty() || key.empty())
+    if (entry != nullptr)
     {
-        throw ini_parser_error("Пустое имя секции или ключа");
+        assign_entry(*entry, value);
+        return;
     }
 
-    // Ищем секцию
-    auto section_it = data.find(section);
+    // Имя существующей секции уже хранится в парсере
+    const ini_section* section_info = data.find_section(section);
+    std::string_view section_name = section_info != nullptr ? section_info->name : store_string(section);
 
-    if (section_it == data.end())
-    {
-        // Формируем список доступных секций для сообщения об ошибке
-        std::vector<std::string> available_sections;
+    data.insert(section_name, store_string(key), store_string(value));
+    layout_changed = true;
+    reset_value_cache();
+}
 
-        for (const auto& [sec, _] : data)
-        {
-            available_sections.push_back(sec);
-        }
+// Новые ключи накапливаются в хранилище и добавляются одним слиянием
+void ini_parser::set_values(std::span<const std::pair<std::string_view, std::string_view>> values)
+{
+    check_not_frozen();
 
-        std::string hint = "Доступные секции: ";
+    std::string_view section;
+    std::string_view key;
 
-        for (size_t i = 0; i < available_sections.size(); ++i)
-        {
-            if (i != 0)
-            {
-                hint += ", ";
-            }
-            hint += available_sections[i];
-        }
+    // Все пути и значения проверяются до первого изменения, в том числе до
+    // разбора секций ленивого парсера
+    for (const auto& [key_path, value] : values)
+    {
+        split_assignment(key_path, value, section, key);
+    }
 
-        throw ini_parser_error("Секция '" + section + "' не найдена. " + hint);
+    if (lazy)
+    {
+        materialize();
     }
 
-    // Ищем ключ в секции
-    auto key_it = section_it->second.find(key);
+    bool inserted = false;
+    std::string_view new_section; // Последняя новая секция: ключи одной секции обычно идут подряд
 
-    if (key_it == section_it->second.end())
+    for (const auto& [key_path, value] : values)
     {
-        // Формируем список доступных ключей для сообщения об ошибке
-        std::vector<std::string> available_keys;
+        split_assignment(key_path, value, section, key);
+        const ini_entry* entry = data.find(section, key);
 
-        for (const auto& [k, _] : section_it->second)
+        if (entry != nullptr)
         {
-            available_keys.push_back(k);
+            assign_entry(*entry, value);
+            continue;
         }
 
-        std::string hint = "Доступные ключи в секции '" + section + "': ";
+        const ini_section* section_info = data.find_section(section);
 
-        for (size_t i = 0; i < available_keys.size(); ++i)
+        if (section_info != nullptr)
         {
-            if (i != 0)
-            {
-                hint += ", ";
-            }
-            hint += available_keys[i];
+            section = section_info->name;
+        }
+        else
+        {
+            new_section = new_section == section ? new_section : store_string(section);
+            section = new_section;
         }
 
-        throw ini_parser_error("Ключ '" + key + "' не найден в секции '" + section + "'. " + hint);
+        data.add_section(section);
+        data.add_value(section, store_string(key), store_string(value), 0);
+        inserted = true;
     }
 
-    return key_it->second;
+    if (inserted)
+    {
+        data.merge_pending();
+        layout_changed = true;
+        reset_value_cache();
+    }
 }
 
-// Создание конфигурационного файла по умолчанию
-void ini_parser::create_default_config(const std::string& filename)
+bool ini_parser::remove_key(std::string_view key_path)
 {
-    std::ofstream out(filename);
-
-    if (out)
-    {
-        out << R"(
-[Section1]
-; Пример секции с русскими комментариями
-var1 = 5
-var2 = Привет, мир!
+    check_not_frozen();
 
-[Section2]
-var1 = 42
-var2 = Тестовая строка
-)";
-        std::cout << "Создан новый конфиг файл: " << filename << std::endl;
-    }
-    else
+    if (lazy)
     {
-        throw ini_parser_error("Не удалось создать файл конфигурации");
+        materialize();
     }
-}#include <iostream>
-#include "ini_parser.h"
-#include <locale>
-#include <codecvt>
 
-// Óäàëåíèå ïðîáåëîâ â íà÷àëå è êîíöå ñòðîêè
-std::string ini_parser::trim(const std::string& str)
-{
-    // Íàõîäèì ïåðâûé íåïðîáåëüíûé ñèìâîë
-    size_t first = str.find_first_not_of(" \t");
+    entry_ref ref;
 
-    // Åñëè ñòðîêà ñîñòîèò òîëüêî èç ïðîáåëîâ
-    if (first == std::string::npos)
+    if (!find_ref(key_path, ref))
     {
-        return "";
+        return false;
     }
 
-    // Íàõîäèì ïîñëåäíèé íåïðîáåëüíûé ñèìâîë
-    size_t last = str.find_last_not_of(" \t");
-    return str.substr(first, (last - first + 1));
+    data.erase(entry_index(*ref.entry));
+    layout_changed = true;
+    reset_value_cache();
+    return true;
 }
 
-// Ðàçäåëåíèå ñòðîêè íà êëþ÷ è çíà÷åíèå
-std::pair<std::string, std::string> ini_parser::split_key_value(const std::string& line, int line_num)
+// Правка исходного текста при сохранении: замена [offset, offset + size) на text
+struct ini_text_edit
 {
-    // Èùåì ïîçèöèþ çíàêà ðàâåíñòâà
-    size_t eq_pos = line.find('=');
+    size_t offset;
+    size_t size;
+    std::string text;
+    bool new_lines; // Вставка целых строк: начинается с новой строки
+};
+
+// Тот же файл под другим именем
+static bool same_file(const std::string& a, const std::string& b)
+{
+    std::error_code error;
+    return a == b || std::filesystem::equivalent(a, b, error);
+}
 
-    // Åñëè çíàê ðàâåíñòâà íå íàéäåí
-    if (eq_pos == std::string::npos)
-    {
-        throw ini_parser_error("Íåêîððåêòíûé ôîðìàò ñòðîêè (îòñóòñòâóåò '=')", line_num);
-    }
+// Конец строки текста, содержащей позицию pos, вместе с переводом строки
+static size_t line_end(std::string_view text, size_t pos)
+{
+    size_t newline = text.find('\n', pos);
+    return newline == std::string_view::npos ? text.size() : newline + 1;
+}
 
-    // Èçâëåêàåì è òðèìèì êëþ÷
-    std::string key = trim(line.substr(0, eq_pos));
+// Конец строки без перевода строки: место под значение вместе с пробелами после него
+static size_t line_content_end(std::string_view text, size_t pos)
+{
+    size_t end = line_end(text, pos);
 
-    // Ïðîâåðÿåì ÷òî êëþ÷ íå ïóñòîé
-    if (key.empty())
+    while (end > pos && (text[end - 1] == '\n' || text[end - 1] == '\r'))
     {
-        throw ini_parser_error("Ïóñòîé êëþ÷", line_num);
+        end--;
     }
 
-    // Èçâëåêàåì è òðèìèì çíà÷åíèå
-    std::string value = trim(line.substr(eq_pos + 1));
-    return std::make_pair(key, value);
+    return end;
 }
 
-// Ïðîâåðêà êîððåêòíîñòè èìåíè ñåêöèè
-void ini_parser::validate_section_name(const std::string& name, int line_num)
+// Привязка записей к тексту последнего сохранения: значения указывают в него,
+// номера строк - строки, где ключ встречается последним, как при разборе
+struct ini_saved_text_binder : ini_event_visitor
 {
-    // Èìÿ ñåêöèè íå ìîæåò áûòü ïóñòûì
-    if (name.empty())
+    ini_storage& data;
+
+    explicit ini_saved_text_binder(ini_storage& data)
+        : data(data)
     {
-        throw ini_parser_error("Ïóñòîå èìÿ ñåêöèè", line_num);
     }
 
-    // Èìÿ ñåêöèè íå äîëæíî ñîäåðæàòü ïðîáåëîâ
-    for (char c : name)
+    void on_key_value(std::string_view section, std::string_view key, std::string_view value, int line)
     {
-        if (std::isspace(c))
+        if (const ini_entry* entry = data.find(section, key))
         {
-            throw ini_parser_error("Èìÿ ñåêöèè ñîäåðæèò ïðîáåëû", line_num);
+            uint32_t index = static_cast<uint32_t>(entry - data.all_entries().data());
+            data.set_entry_value(index, value);
+            data.set_entry_line(index, static_cast<uint32_t>(line));
         }
     }
-}
+};
 
-// Ïðîâåðêà êîððåêòíîñòè èìåíè êëþ÷à
-void ini_parser::validate_key_name(const std::string& name, int line_num)
+// Прежнее значение, если оно лежит в исходном тексте, можно переписать на месте;
+// значение, измененное после загрузки (номер строки 0), уже учтено
+void ini_parser::record_value_patch(uint32_t entry)
 {
-    // Êëþ÷ íå ìîæåò áûòü ïóñòûì
-    if (name.empty())
+    const ini_entry& item = data.all_entries()[entry];
+
+    if (item.line == 0)
     {
-        throw ini_parser_error("Ïóñòîé êëþ÷", line_num);
+        return;
     }
 
-    // Êëþ÷ íå äîëæåí ñîäåðæàòü ïðîáåëîâ
-    for (char c : name)
+    std::less_equal<const char*> not_after;
+
+    if (!source_text.empty() && not_after(source_text.data(), item.value.data()) &&
+        not_after(item.value.data() + item.value.size(), source_text.data() + source_text.size()))
     {
-        if (std::isspace(c))
-        {
-            throw ini_parser_error("Êëþ÷ ñîäåðæèò ïðîáåëû", line_num);
-        }
+        value_patches.push_back({ entry, static_cast<size_t>(item.value.data() - source_text.data()), item.line });
+    }
+    else
+    {
+        layout_changed = true;
     }
 }
 
-// Îñíîâíîé ìåòîä ïàðñèíãà INI-ôàéëà
-void ini_parser::parse_file(std::istream& stream)
+// Запись новых значений поверх прежних, если каждое помещается в свою строку,
+// а файл не менялся после загрузки или сохранения
+bool ini_parser::save_in_place(const std::string& target)
 {
-    std::string current_section;
-    std::string line;
-    int line_num = 0;
+    std::string_view text = source_text;
+    std::vector<size_t> room(value_patches.size());
 
-    // ×èòàåì ôàéë ïîñòðî÷íî
-    while (std::getline(stream, line))
+    for (size_t i = 0; i < value_patches.size(); ++i)
     {
-        line_num++;
-        line = trim(line);
+        room[i] = line_content_end(text, value_patches[i].offset) - value_patches[i].offset;
 
-        // Ïðîïóñêàåì ïóñòûå ñòðîêè è êîììåíòàðèè
-        if (line.empty() || line[0] == ';')
+        if (data.all_entries()[value_patches[i].entry].value.size() > room[i])
         {
-            continue;
+            return false;
         }
+    }
 
-        // Îáðàáîòêà ñåêöèè
-        if (line[0] == '[')
+    {
+        ini_mapped_file current;
+
+        if (!current.open(target) || current.view() != text)
         {
-            // Ïðîâåðÿåì ÷òî ñåêöèÿ çàêðûòà
-            if (line.back() != ']')
-            {
-                throw ini_parser_error("Íåêîððåêòíîå îáúÿâëåíèå ñåêöèè - îòñóòñòâóåò ']'", line_num);
-            }
+            return false;
+        }
+    }
 
-            // Èçâëåêàåì èìÿ ñåêöèè
-            current_section = trim(line.substr(1, line.size() - 2));
-            validate_section_name(current_section, line_num);
+    std::fstream file(target, std::ios::in | std::ios::out | std::ios::binary);
 
-            // Äîáàâëÿåì ñåêöèþ â äàííûå
-            data[current_section];
-            continue;
-        }
+    if (!file)
+    {
+        return false;
+    }
+
+    // Текст загрузки копируется, чтобы его можно было править; записи переносятся
+    // в копию, и следующие изменения тоже записываются на место
+    if (saved_text.data() != text.data())
+    {
+        saved_text.assign(text.begin(), text.end());
+        source_text = std::string_view(saved_text.data(), saved_text.size());
+        std::less_equal<const char*> not_after;
 
-        // Ïðîâåðÿåì ÷òî êëþ÷-çíà÷åíèå íàõîäèòñÿ âíóòðè ñåêöèè
-        if (current_section.empty())
+        for (uint32_t i = 0; i < data.all_entries().size(); ++i)
         {
-            throw ini_parser_error("Êëþ÷-çíà÷åíèå âíå ñåêöèè", line_num);
+            const ini_entry& entry = data.all_entries()[i];
+
+            if (not_after(text.data(), entry.value.data()) && not_after(entry.value.data() + entry.value.size(), text.data() + text.size()))
+            {
+                uint32_t line = entry.line;
+                data.set_entry_value(i, source_text.substr(static_cast<size_t>(entry.value.data() - text.data()), entry.value.size()));
+                data.set_entry_line(i, line);
+            }
         }
+    }
+
+    std::string padded;
+
+    for (size_t i = 0; i < value_patches.size(); ++i)
+    {
+        const value_patch& patch = value_patches[i];
+        padded.assign(data.all_entries()[patch.entry].value);
+        size_t value_size = padded.size();
+        padded.resize(room[i], ' ');
 
-        // Ðàçäåëÿåì êëþ÷ è çíà÷åíèå
-        auto kv_pair = split_key_value(line, line_num);
-        validate_key_name(kv_pair.first, line_num);
+        file.seekp(static_cast<std::streamoff>(patch.offset));
+        file.write(padded.data(), static_cast<std::streamsize>(padded.size()));
+        std::copy(padded.begin(), padded.end(), saved_text.begin() + static_cast<std::ptrdiff_t>(patch.offset));
 
-        // Ñîõðàíÿåì çíà÷åíèå
-        data[current_section][kv_pair.first] = kv_pair.second;
+        data.set_entry_value(patch.entry, source_text.substr(patch.offset, value_size));
+        data.set_entry_line(patch.entry, patch.line);
     }
+
+    if (!file.flush())
+    {
+        throw ini_parser_error("Не удалось записать файл: " + target);
+    }
+
+    value_patches.clear();
+    return true;
 }
 
-// Êîíñòðóêòîð ïàðñåðà
-ini_parser::ini_parser(const std::string& filename, bool create_default)
-    : filename(filename), use_default_config(false)
+void ini_parser::adopt_saved_text(const std::string& target, std::pmr::vector<char>& text)
 {
-    // Ïûòàåìñÿ îòêðûòü ôàéë
-    std::ifstream file(filename);
+    saved_text.swap(text);
+    source_text = std::string_view(saved_text.data(), saved_text.size());
 
-    if (!file)
-    {
-        // Åñëè ôàéë íå íàéäåí è ðàçðåøåíî ñîçäàíèå ïî óìîë÷àíèþ
-        if (create_default)
-        {
-            // Èñïîëüçóåì âñòðîåííóþ êîíôèãóðàöèþ
-            std::istringstream default_config(R"(
-[Section1]
-; Ïðèìåð ñåêöèè ñ ðóññêèìè êîììåíòàðèÿìè
-var1 = 5
-var2 = Ïðèâåò, ìèð!
+    ini_saved_text_binder binder(data);
+    ini_read_events(source_text, binder);
+    value_patches.clear();
+    layout_changed = false;
 
-[Section2]
-var1 = 42
-var2 = Òåñòîâàÿ ñòðîêà
-)");
-            use_default_config = true;
-            parse_file(default_config);
-            create_default_config(filename);
-        }
-        else
-        {
-            throw ini_parser_error("Íå óäàëîñü îòêðûòü ôàéë: " + filename);
-        }
-    }
-    else
+    uint32_t line_count = static_cast<uint32_t>(std::count(source_text.begin(), source_text.end(), '\n') + 1);
+    sources.assign(1, { target, 0, line_count });
+}
+
+void ini_parser::save(ini_save_mode mode)
+{
+    if (filename.empty())
     {
-        // Ïàðñèì ñóùåñòâóþùèé ôàéë
-        parse_file(file);
+        throw ini_parser_error("Не задан файл для сохранения");
     }
+
+    save(filename, mode);
 }
 
-// Ïîëó÷åíèå ñòðîêîâîãî çíà÷åíèÿ ïî êëþ÷ó
-std::string ini_parser::get_value_as_string(const std::string& key_path)
+void ini_parser::save(const std::string& target, ini_save_mode mode)
 {
-    // Ðàçäåëÿåì ïóòü íà ñåêöèþ è êëþ÷
-    size_t dot_pos = key_path.find('.');
+    // Неразобранный ленивый парсер не изменялся: текст записывается как есть
+    if (lazy)
+    {
+        if (!ini_replace_file(target, { lazy_text }))
+        {
+            throw ini_parser_error("Не удалось записать файл: " + target);
+        }
+        return;
+    }
 
-    if (dot_pos == std::string::npos)
+    // Изменены только значения: сначала попытка записи на месте
+    if (mode == ini_save_mode::incremental && !layout_changed && !source_text.empty() &&
+        same_file(target, filename) && save_in_place(target))
     {
-        throw ini_parser_error("Íåêîððåêòíûé ôîðìàò êëþ÷à (îòñóòñòâóåò '.')");
+        return;
     }
 
-    std::string section = key_path.substr(0, dot_pos);
-    std::string key = key_path.substr(dot_pos + 1);
+    const std::pmr::vector<ini_section>& sections = data.all_sections();
+    const std::pmr::vector<ini_entry>& entries = data.all_entries();
+    std::string_view text = source_text;
+    std::string_view newline = text.find("\r\n") != std::string_view::npos ? "\r\n" : "\n";
+    std::pmr::vector<char> output(resource);
 
-    // Ïðîâåðÿåì ÷òî ñåêöèÿ è êëþ÷ íå ïóñòûå
-    if (section.empty() || key.empty())
+    // Без исходного текста записываются все секции по порядку
+    if (text.empty())
     {
-        throw ini_parser_error("Ïóñòîå èìÿ ñåêöèè èëè êëþ÷à");
-    }
+        auto append = [&output](std::string_view str)
+        {
+            output.insert(output.end(), str.begin(), str.end());
+        };
+
+        for (const ini_section& section : sections)
+        {
+            if (!output.empty())
+            {
+                append(newline);
+            }
+
+            append("[");
+            append(section.name);
+            append("]");
+            append(newline);
+
+            for (uint32_t i = section.first_entry; i < section.first_entry + section.entry_count; ++i)
+            {
+                append(entries[i].key);
+                append(" = ");
+                append(entries[i].value);
+                append(newline);
+            }
+        }
+
+        if (!ini_replace_file(target, { std::string_view(output.data(), output.size()) }))
+        {
+            throw ini_parser_error("Не удалось записать файл: " + target);
+        }
 
-    // Èùåì ñåêöèþ
-    auto section_it = data.find(section);
+        adopt_saved_text(target, output);
+        return;
+    }
 
-    if (section_it == data.end())
+    // Сопоставление строк текста с записями: строки удаленных ключей убираются,
+    // значения измененных (номер строки 0) заменяются во всех вхождениях ключа.
+    // Заодно запоминается конец последней строки каждой секции - место для новых ключей
+    struct edit_collector : ini_event_visitor
     {
-        // Ôîðìèðóåì ñïèñîê äîñòóïíûõ ñåêöèé äëÿ ñîîáùåíèÿ îá îøèáêå
-        std::vector<std::string> available_sections;
+        const ini_storage& data;
+        std::string_view text;
+        std::vector<ini_text_edit> edits;
+        std::vector<bool> seen;
+        std::vector<size_t> section_end;
+
+        edit_collector(const ini_storage& data, std::string_view text)
+            : data(data), text(text), seen(data.all_entries().size()),
+              section_end(data.all_sections().size(), std::string_view::npos)
+        {
+        }
 
-        for (const auto& [sec, _] : data)
+        size_t offset(std::string_view part) const
         {
-            available_sections.push_back(sec);
+            return static_cast<size_t>(part.data() - text.data());
         }
 
-        std::string hint = "Äîñòóïíûå ñåêöèè: ";
+        void on_section(std::string_view name, int line)
+        {
+            (void)line;
+
+            if (const ini_section* section = data.find_section(name))
+            {
+                section_end[section - data.all_sections().data()] = line_end(text, offset(name));
+            }
+        }
 
-        for (size_t i = 0; i < available_sections.size(); ++i)
+        void on_key_value(std::string_view section, std::string_view key, std::string_view value, int line)
         {
-            if (i != 0)
+            (void)line;
+
+            const ini_entry* entry = data.find(section, key);
+            size_t end = line_end(text, offset(value));
+
+            if (entry == nullptr)
+            {
+                size_t start = text.rfind('\n', offset(key));
+                start = start == std::string_view::npos ? 0 : start + 1;
+                edits.push_back({ start, end - start, {}, false });
+                return;
+            }
+
+            uint32_t index = static_cast<uint32_t>(entry - data.all_entries().data());
+            seen[index] = true;
+            section_end[entry->section] = end;
+
+            // Заменяется и хвост строки из пробелов (в том числе дополнение прежней записи на месте)
+            if (entry->line == 0)
             {
-                hint += ", ";
+                size_t value_end = line_content_end(text, offset(value) + value.size());
+                std::string replacement = value.empty() && text[offset(value) - 1] == '=' ? " " : "";
+                replacement += entry->value;
+                edits.push_back({ offset(value), value_end - offset(value), std::move(replacement), false });
             }
-            hint += available_sections[i];
         }
+    };
 
-        throw ini_parser_error("Ñåêöèÿ '" + section + "' íå íàéäåíà. " + hint);
-    }
+    edit_collector collector(data, text);
+    ini_read_events(text, collector);
+    std::vector<ini_text_edit>& edits = collector.edits;
 
-    // Èùåì êëþ÷ â ñåêöèè
-    auto key_it = section_it->second.find(key);
+    // Новые ключи - после последней строки своей секции, новые секции - в конец
+    std::string appended;
 
-    if (key_it == section_it->second.end())
+    for (uint32_t s = 0; s < sections.size(); ++s)
     {
-        // Ôîðìèðóåì ñïèñîê äîñòóïíûõ êëþ÷åé äëÿ ñîîáùåíèÿ îá îøèáêå
-        std::vector<std::string> available_keys;
+        std::string lines;
 
-        for (const auto& [k, _] : section_it->second)
+        for (uint32_t i = sections[s].first_entry; i < sections[s].first_entry + sections[s].entry_count; ++i)
         {
-            available_keys.push_back(k);
+            if (!collector.seen[i])
+            {
+                lines.append(entries[i].key).append(" = ").append(entries[i].value).append(newline);
+            }
         }
 
-        std::string hint = "Äîñòóïíûå êëþ÷è â ñåêöèè '" + section + "': ";
+        if (lines.empty())
+        {
+            continue;
+        }
 
-        for (size_t i = 0; i < available_keys.size(); ++i)
+        if (collector.section_end[s] != std::string_view::npos)
         {
-            if (i != 0)
-            {
-                hint += ", ";
-            }
-            hint += available_keys[i];
+            edits.push_back({ collector.section_end[s], 0, std::move(lines), true });
         }
+        else
+        {
+            appended.append(newline).append("[").append(sections[s].name).append("]").append(newline).append(lines);
+        }
+    }
+
+    if (!appended.empty())
+    {
+        edits.push_back({ text.size(), 0, std::move(appended), true });
+    }
+
+    // Правки упорядочены по месту; вставка в конец секции идет раньше удаления
+    // следующей за ней строки
+    std::stable_sort(edits.begin(), edits.end(), [](const ini_text_edit& a, const ini_text_edit& b)
+    {
+        return a.offset != b.offset ? a.offset < b.offset : a.new_lines && !b.new_lines;
+    });
+
+    size_t total = text.size();
+
+    for (const ini_text_edit& edit : edits)
+    {
+        total += edit.text.size() + newline.size();
+    }
+
+    output.reserve(total);
+    size_t pos = 0;
+
+    for (const ini_text_edit& edit : edits)
+    {
+        output.insert(output.end(), text.begin() + pos, text.begin() + edit.offset);
 
-        throw ini_parser_error("Êëþ÷ '" + key + "' íå íàéäåí â ñåêöèè '" + section + "'. " + hint);
+        // Вставляемые строки начинаются с новой строки, даже если в конце текста нет перевода
+        if (edit.new_lines && !output.empty() && output.back() != '\n')
+        {
+            output.insert(output.end(), newline.begin(), newline.end());
+        }
+
+        output.insert(output.end(), edit.text.begin(), edit.text.end());
+        pos = edit.offset + edit.size;
+    }
+
+    output.insert(output.end(), text.begin() + pos, text.end());
+
+    if (!ini_replace_file(target, { std::string_view(output.data(), output.size()) }))
+    {
+        throw ini_parser_error("Не удалось записать файл: " + target);
     }
 
-    return key_it->second;
+    adopt_saved_text(target, output);
 }
 
-// Ñîçäàíèå êîíôèãóðàöèîííîãî ôàéëà ïî óìîë÷àíèþ
+// Создание конфигурационного файла по умолчанию
 void ini_parser::create_default_config(const std::string& filename)
 {
     std::ofstream out(filename);
 
     if (out)
     {
-        out << R"(
-[Section1]
-; Ïðèìåð ñåêöèè ñ ðóññêèìè êîììåíòàðèÿìè
-var1 = 5
-var2 = Ïðèâåò, ìèð!
-
-[Section2]
-var1 = 42
-var2 = Òåñòîâàÿ ñòðîêà
-)";
-        std::cout << "Ñîçäàí íîâûé êîíôèã ôàéë: " << filename << std::endl;
+        out << default_config_text;
+        std::cout << "Создан новый конфиг файл: " << filename << std::endl;
     }
     else
     {
-        throw ini_parser_error("Íå óäàëîñü ñîçäàòü ôàéë êîíôèãóðàöèè");
+        throw ini_parser_error("Не удалось создать файл конфигурации");
     }
 }
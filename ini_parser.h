@@ -1,7 +1,7 @@
 #pragma once
 
 #include <string>
-#include <map>
+#include <string_view>
 #include <vector>
 #include <stdexcept>
 #include <type_traits>
@@ -9,140 +9,993 @@
 #include <algorithm>
 #include <cctype>
 #include <fstream>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <optional>
+#include <memory_resource>
+#include <deque>
+#include <mutex>
+#include <exception>
+#include <iterator>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <span>
+#include "ini_error.h"
+#include "ini_convert.h"
+#include "ini_mapped_file.h"
+#include "ini_storage.h"
+#include "ini_section_index.h"
+#include "ini_snapshot.h"
+#include "ini_stats.h"
+#include "ini_encoding.h"
 
-// Класс для обработки ошибок парсера
-class ini_parser_error : public std::runtime_error
+// Способ загрузки файла конфигурации
+enum class ini_load_mode
+{
+    stream, // Чтение через std::ifstream в собственный буфер
+    mapped, // Отображение файла в память без копирования
+    read    // Чтение целиком системными вызовами в собственный буфер (быстрее для небольших файлов)
+};
+
+// Ход загрузки: этап (ini_parse_stage::read или tokenize), обработано байт и всего байт этапа
+using ini_load_progress = std::function<void(ini_parse_stage stage, uint64_t done, uint64_t total)>;
+
+// Источник текста конфигурации блоками: распаковка gzip, ответ сервера,
+// хранилище объектов. Блоки не обязаны совпадать с границами строк
+class ini_chunk_reader
 {
 public:
-    // Конструктор с сообщением об ошибке и необязательным номером строки
-    explicit ini_parser_error(const std::string& msg, int line = -1)
-        : std::runtime_error(line == -1 ? msg : "Ошибка в строке " + std::to_string(line) + ": " + msg)
+    virtual ~ini_chunk_reader() = default;
+
+    // Запись следующих байт в buffer (не больше size): число записанных байт,
+    // 0 - конец данных. Ошибка источника сообщается исключением
+    virtual size_t read(char* buffer, size_t size) = 0;
+
+    // Общий размер текста, если он известен заранее (0 - неизвестен)
+    virtual size_t size_hint() const
     {
+        return 0;
     }
 };
 
-// Основной класс парсера INI-файлов
+// Параметры создания парсера
+struct ini_parser_options
+{
+    ini_load_mode load_mode = ini_load_mode::stream; // Способ загрузки файла
+    bool create_default = false;                     // Создавать конфиг по умолчанию, если файла нет
+    unsigned parse_threads = 1;                      // Потоков разбора (1 - последовательно, 0 - все ядра)
+
+    // Ленивый разбор: при загрузке запоминаются только заголовки секций и их
+    // участки текста, содержимое секции разбирается при первом обращении к ней.
+    // Ошибки в строках ключей выбрасываются при обращении к секции, parse_threads
+    // не учитывается. Сочетается с обоими способами загрузки
+    bool lazy = false;
+
+    // Сбор ошибок вместо исключения: разбор проходит файл целиком, строки
+    // с ошибками пропускаются, все ошибки доступны через diagnostics().
+    // Конструктор по-прежнему выбрасывает ini_parser_error, если файл не
+    // открылся. Требует полного разбора (lazy не учитывается); текст с ошибками
+    // не записывается в снимок. load_layers ошибки не собирает
+    bool collect_errors = false;
+
+    // Кодировка текста. Метка порядка байт (BOM) в начале текста важнее
+    // указанной кодировки и отбрасывается. Текст UTF-8 разбирается на месте
+    // после векторной проверки, остальные перекодируются в UTF-8 в собственный
+    // буфер (отображение файла при этом не используется). Некорректный текст -
+    // ini_parser_error с номером строки, даже при collect_errors. Снимок
+    // пишется только для текста в UTF-8; save всегда записывает UTF-8 без BOM
+    ini_encoding encoding = ini_encoding::auto_detect;
+
+    // Двоичный снимок разобранного состояния (пустой путь - не используется).
+    // Пока снимок соответствует файлу (размер и время изменения; при другом
+    // времени изменения сверяется хеш содержимого), парсер загружается из него
+    // без разбора текста. Иначе текст разбирается полностью (lazy не учитывается)
+    // и снимок перезаписывается
+    std::string snapshot_file = {};
+
+    // Многофайловая загрузка (ini_parser::load_layers): пропускать отсутствующие
+    // файлы слоев. Файлы из директив !include обязательны
+    bool skip_missing_layers = false;
+
+    // Память парсера: собственная арена (monotonic_buffer_resource, освобождается
+    // целиком при уничтожении парсера) или ресурс вызывающего кода. Ресурс должен
+    // жить дольше парсера; если задан memory_resource, use_arena не учитывается
+    bool use_arena = false;
+    std::pmr::memory_resource* memory_resource = nullptr;
+
+    // Сообщения о ходе загрузки файла конструктором (пусто - без сообщений).
+    // Вызывается в загружающем потоке после каждого блока около 1 МБ: при
+    // чтении через поток и при последовательном разборе построчно целыми
+    // блоками. Отображение, чтение целиком (read), параллельный и ленивый
+    // разбор сообщают о своем этапе один раз по его завершении; снимок
+    // и load_layers не сообщают
+    ini_load_progress progress = {};
+};
+
+// Способ сохранения конфигурации в файл
+enum class ini_save_mode
+{
+    full,       // Файл собирается заново и записывается целиком
+    incremental // Только измененные значения на месте, если это возможно
+};
+
+// Источник значения для диагностики
+struct ini_value_origin
+{
+    std::string_view file; // Файл, из которого взято значение (пусто для set_value)
+    int line;              // Номер строки в этом файле (0 для set_value)
+};
+
+// Основной класс парсера INI-файлов.
+// Потокобезопасность: константные методы (get_value, try_get_value, resolve) можно
+// вызывать из любого числа потоков одновременно без внешней синхронизации - кеш
+// преобразованных значений заполняется атомарно. Изменяющие методы (set_value)
+// требуют исключительного доступа; для изменений при параллельном чтении служит
+// ini_concurrent_parser, публикующий измененные копии
 class ini_parser
 {
 private:
-    // Структура для хранения данных: секция -> (ключ -> значение)
-    std::map<std::string, std::map<std::string, std::string>> data;
+    friend class ini_shared_publisher; // Снимок хранилища для общей памяти
+
+    // Собственная арена и ресурс, из которого выделяется вся память парсера.
+    // Объявлены первыми, чтобы освобождаться после всех контейнеров
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+    std::pmr::memory_resource* resource;
+
+    // Плоское хранилище секций и пар ключ-значение.
+    // Строки указывают в буфер с текстом конфига (owned_buffer, mapped_file
+    // или встроенную конфигурацию) и в assigned_strings, поэтому копия парсера
+    // переносит все строки в собственный буфер
+    ini_storage data;
+
+    // Разобранный список значения (get_array): элементы одного типа подряд.
+    // Узел и элементы - один блок array_alignment-выровненной памяти; элементы
+    // начинаются через array_alignment байт от узла, хвост блока заполнен нулями
+    struct array_cache
+    {
+        const array_cache* next; // Список того же значения с другим типом элементов
+        const void* type;        // &list_tag<T>
+        const void* items;
+        size_t size;
+        size_t bytes;            // Размер блока для освобождения
+    };
+
+    static constexpr size_t array_alignment = 64;
+
+    // Кеш преобразованных значений одной записи: битовая маска заполненных
+    // ячеек и сами значения (побитовая копия). Ячейка публикуется после записи
+    // значения, поэтому читатель никогда не видит частично заполненную ячейку.
+    // Списки добавляются в начало arrays и публикуются так же
+    struct typed_cache
+    {
+        std::atomic<uint32_t> valid{ 0 };
+        std::atomic<uint64_t> values[ini_cache_slot_count] = {};
+        std::atomic<const array_cache*> arrays{ nullptr };
+
+#if INI_PARSER_STATS
+        ini_key_counters counters; // Чтения записи для ini_parser::stats
+#endif
+
+        typed_cache() = default;
+
+        // Копирование возможно при параллельном чтении исходного кеша: маска
+        // читается с acquire, поэтому каждая отмеченная в ней ячейка уже записана.
+        // Списки не копируются: они лежат в памяти исходного парсера
+        typed_cache(const typed_cache& other)
+            : valid(other.valid.load(std::memory_order_acquire))
+#if INI_PARSER_STATS
+            , counters(other.counters)
+#endif
+        {
+            for (int i = 0; i < ini_cache_slot_count; ++i)
+            {
+                values[i].store(other.values[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+    };
+
+    // Кеш по одному элементу на запись хранилища, пересоздается при каждом разборе.
+    // Заполняется из константных методов чтения, поэтому mutable
+    mutable std::pmr::vector<typed_cache> value_cache;
+
+    // Хеш содержимого секции (section_view::content_hash), вычисляемый при
+    // первом обращении; 0 - еще не вычислен. Копия - невычисленная ячейка
+    struct section_hash_slot
+    {
+        std::atomic<uint64_t> hash{ 0 };
+
+        section_hash_slot() = default;
+
+        section_hash_slot(const section_hash_slot&)
+        {
+        }
+    };
+
+    // По ячейке на секцию общего хранилища
+    mutable std::pmr::vector<section_hash_slot> section_hashes;
+
+    // Память разобранных списков: пул поверх resource. Списки строятся из
+    // константных методов под mutex, поэтому пул (и непотокобезопасная арена
+    // под ним) используется одним потоком
+    struct array_store
+    {
+        std::mutex mutex;
+        std::pmr::unsynchronized_pool_resource pool;
+
+        explicit array_store(std::pmr::memory_resource* upstream)
+            : pool(upstream)
+        {
+        }
+    };
+
+    std::unique_ptr<array_store> arrays;
+
+    // Найденная запись и ее кеш: в общем хранилище (lazy_section == 0)
+    // или в секции ленивого режима с индексом lazy_section - 1
+    struct entry_ref
+    {
+        const ini_entry* entry;
+        typed_cache* cache;
+        uint32_t lazy_section;
+    };
+
+    // Разобранная секция ленивого режима
+    struct parsed_section
+    {
+        ini_storage storage;
+        mutable std::pmr::vector<typed_cache> cache;
+        mutable std::atomic<uint64_t> hash{ 0 }; // Хеш содержимого (как section_hashes)
+        std::exception_ptr error; // Ошибка разбора, выбрасываемая при каждом обращении
+
+        explicit parsed_section(std::pmr::memory_resource* resource)
+            : storage(resource), cache(resource)
+        {
+        }
+    };
+
+    // Ячейка секции ленивого режима: разобранная секция публикуется один раз.
+    // Копия - неразобранная ячейка (контейнер копирует ячейки только до обращений читателей)
+    struct lazy_section
+    {
+        std::atomic<const parsed_section*> parsed{ nullptr };
+
+        lazy_section() = default;
+
+        lazy_section(const lazy_section&)
+        {
+        }
+    };
+
+    // Кодировка загруженного текста (определенная по BOM или указанная)
+    ini_encoding text_encoding = ini_encoding::utf8;
+
+    // Сбор ошибок разбора (ini_parser_options::collect_errors) и ошибки последнего разбора
+    bool collect_errors;
+    std::vector<ini_diagnostic> load_diagnostics;
+
+    // Ленивый режим: индекс секций текста lazy_text, по ячейке на секцию индекса
+    // и сами разобранные секции (deque не перемещает элементы при добавлении)
+    bool lazy;
+    std::string_view lazy_text;
+    ini_section_index section_index;
+    mutable std::pmr::vector<lazy_section> lazy_sections;
+    mutable std::pmr::deque<parsed_section> parsed_sections;
+    std::unique_ptr<std::mutex> lazy_mutex; // Секции разбираются по одной
+
+    // Буфер с содержимым файла при загрузке через поток (или строки копии парсера)
+    std::pmr::vector<char> owned_buffer;
+
+    // Текст, по которому построены записи (для сохранения с комментариями и порядком
+    // строк), и текст последнего сохранения или копии, если исходный текст - он
+    std::string_view source_text;
+    std::pmr::vector<char> saved_text;
+
+    // Значения, измененные после загрузки или сохранения, для записи на месте:
+    // запись, положение ее прежнего значения в source_text и строка
+    struct value_patch
+    {
+        uint32_t entry;
+        size_t offset;
+        uint32_t line;
+    };
+
+    std::vector<value_patch> value_patches;
+    bool layout_changed = false; // Ключи добавлялись или удалялись: на месте не записать
+
+    bool is_frozen = false; // После freeze изменения запрещены
+
+    // Строки, заданные через set_value, и тексты файлов многофайловой конфигурации;
+    // deque не перемещает элементы при добавлении
+    std::pmr::deque<std::pmr::string> assigned_strings;
+
+    // Отображение файла при загрузке в режиме ini_load_mode::mapped
+    ini_mapped_file mapped_file;
 
     // Имя файла конфигурации
     std::string filename;
 
+    // Файлы, из которых собрана конфигурация. Номера строк записей сквозные:
+    // строки файла занимают номера first_line + 1 ... first_line + line_count
+    struct source_file
+    {
+        std::string name;
+        uint32_t first_line;
+        uint32_t line_count;
+    };
+
+    std::vector<source_file> sources;
+
     // Флаг использования встроенной конфигурации
     bool use_default_config;
 
+    // Получатель хода загрузки на время конструктора (nullptr - не сообщать)
+    const ini_load_progress* load_progress = nullptr;
+
+    // Время этапов загрузки и промахи поиска (без INI_PARSER_STATS - пустой объект)
+    mutable ini_parser_counters counters;
+
     // Вспомогательные методы
-    std::string trim(const std::string& str); // Удаление пробелов
-    std::pair<std::string, std::string> split_key_value(const std::string& line, int line_num); // Разделение ключа и значения
-    void validate_section_name(const std::string& name, int line_num); // Проверка имени секции
-    void validate_key_name(const std::string& name, int line_num); // Проверка имени ключа
-    void parse_file(std::istream& stream); // Основной метод парсинга
-    std::string get_value_as_string(const std::string& key_path); // Получение строкового значения
+    static void validate_section_name(std::string_view name, bool has_space, int line_num); // Проверка имени секции
+    static void validate_key_name(std::string_view name, bool has_space, int line_num); // Проверка имени ключа
+    void load_file(const ini_parser_options& options); // Загрузка файла filename конструктором
+    void parse_file(std::istream& stream, unsigned threads, ini_encoding encoding); // Чтение потока в буфер и его разбор
+    std::string_view decode_text(std::string_view raw, ini_encoding encoding); // Текст загрузки в UTF-8
+    void report_progress(ini_parse_stage stage, uint64_t done, uint64_t total) const; // Сообщение о ходе загрузки
+    void parse_buffer(std::string_view buffer, unsigned threads); // Основной метод парсинга
+    void throw_first_diagnostic() const; // Первая ошибка разбора, если ошибки не собираются
+    void reset_value_cache(); // Пустой кеш значений и списков для нового набора записей
+    static void split_assignment(std::string_view key_path, std::string_view value, std::string_view& section,
+        std::string_view& key); // Проверка пути и значения для set_value
+    void assign_entry(const ini_entry& entry, std::string_view value); // Новое значение существующей записи
+    void release_arrays(typed_cache& cache); // Освобождение списков одной записи
+    bool parse_chunks(ini_chunk_reader& reader, ini_encoding encoding); // Разбор блоков по мере чтения
+    static void parse_chunk(std::string_view buffer, int first_line, ini_storage& target,
+        std::vector<ini_diagnostic>& diagnostics); // Разбор фрагмента
+    void build_lazy_index(std::string_view buffer); // Быстрый проход ленивого режима
+    const parsed_section& parse_lazy_section(uint32_t section) const; // Разбор секции при первом обращении
+    void materialize(); // Полный разбор ленивого парсера перед изменением
+    void check_not_frozen() const; // ini_parser_error для изменения замороженного парсера
+    void record_value_patch(uint32_t entry);                                        // Место прежнего значения
+    bool save_in_place(const std::string& target);                                  // Запись только измененных значений
+    void adopt_saved_text(const std::string& target, std::pmr::vector<char>& text); // Записанный текст как исходный
+    struct layer_builder; // Потребитель событий многофайловой загрузки
+    void load_layer(const std::string& layer, std::vector<std::string>& include_stack); // Разбор слоя или включаемого файла
+    ini_value_origin entry_origin(const ini_entry& entry) const; // Файл и строка записи
+    bool load_snapshot(const std::string& snapshot_file, int64_t source_mtime); // Загрузка из двоичного снимка
+    void save_snapshot(const std::string& snapshot_file, std::string_view text, int64_t source_mtime) const; // Запись снимка
+
+    // Параллельный разбор включается для буферов не меньше этого размера,
+    // фрагмент на один поток - не меньше parallel_parse_min_chunk байт
+    static constexpr size_t parallel_parse_min_size = 1024 * 1024;
+    static constexpr size_t parallel_parse_min_chunk = 256 * 1024;
+
+    // Блок чтения и разбора между сообщениями о ходе загрузки
+    static constexpr size_t progress_block_size = 1024 * 1024;
+
+    // Блок чтения from_chunks при неизвестном размере текста
+    static constexpr size_t chunk_block_size = 256 * 1024;
+    bool lookup(std::string_view key_path, entry_ref& ref) const; // Поиск записи без исключений
+    bool find_ref(std::string_view key_path, entry_ref& ref) const; // То же без учета в статистике
+    std::string_view store_string(std::string_view str); // Копия строки во владении парсера
+    entry_ref find_entry(std::string_view key_path) const; // Поиск записи с диагностикой ошибок
+    std::string_view get_value_as_string(std::string_view key_path) const; // Получение строкового значения
+
+    // Индекс записи в хранилище
+    uint32_t entry_index(const ini_entry& entry) const
+    {
+        return static_cast<uint32_t>(&entry - data.all_entries().data());
+    }
+
+    // Запись по индексам из дескриптора ключа; секция ленивого режима уже разобрана
+    entry_ref handle_ref(uint32_t lazy_section, uint32_t entry) const
+    {
+        if (lazy_section == 0)
+        {
+            return { &data.all_entries()[entry], &value_cache[entry], 0 };
+        }
+
+        const parsed_section& parsed = *lazy_sections[lazy_section - 1].parsed.load(std::memory_order_acquire);
+        return { &parsed.storage.all_entries()[entry], &parsed.cache[entry], lazy_section };
+    }
+
+    // Ошибка преобразования значения в тип T
+    template<typename T>
+    static ini_parser_error conversion_error(std::string_view str)
+    {
+        return ini_parser_error("Не удалось преобразовать '" + std::string(str) + "' в " + ini_value_traits<T>::name);
+    }
+
+    // Преобразование строки в нужный тип по правилам ini_value_traits
+    template<typename T>
+    T convert_value(std::string_view str) const
+    {
+        T result;
+
+        if (!ini_value_traits<T>::parse(str, result))
+        {
+            throw conversion_error<T>(str);
+        }
+
+        return result;
+    }
+
+    // Учет чтения записи в статистике
+    static void count_read(const entry_ref& ref, bool converted)
+    {
+#if INI_PARSER_STATS
+        ref.cache->counters.count_read(converted);
+#else
+        (void)ref;
+        (void)converted;
+#endif
+    }
+
+    // Значение записи в нужном типе без исключений: первое успешное
+    // преобразование запоминается в кеше, неудачное не кешируется
+    template<typename T>
+    bool try_cached_value(const entry_ref& ref, T& out) const
+    {
+        bool converted = convert_cached(ref, out);
+        count_read(ref, converted);
+        return converted;
+    }
+
+    template<typename T>
+    bool convert_cached(const entry_ref& ref, T& out) const
+    {
+        using traits = ini_value_traits<T>;
+        std::string_view value = ref.entry->value;
+
+        if constexpr (cached_list<T>::value)
+        {
+            // Вектор - копия разобранного один раз списка
+            using item = list_item_t<typename T::value_type>;
+            size_t bad_item;
+            const array_cache* node = find_array<item>(ref, bad_item);
+
+            if (node == nullptr)
+            {
+                return false;
+            }
+
+            const item* items = static_cast<const item*>(node->items);
+            out.assign(items, items + node->size);
+            return true;
+        }
+        else if constexpr (traits::cache_slot < 0)
+        {
+            return traits::parse(value, out);
+        }
+        else
+        {
+            using cache_type = typename traits::cache_type;
+            static_assert(sizeof(cache_type) <= sizeof(uint64_t) && std::is_trivially_copyable_v<cache_type>);
+
+            constexpr uint32_t bit = 1u << traits::cache_slot;
+            typed_cache& cache = *ref.cache;
+            cache_type cached;
+
+            if (cache.valid.load(std::memory_order_acquire) & bit)
+            {
+                uint64_t bits = cache.values[traits::cache_slot].load(std::memory_order_relaxed);
+                std::memcpy(&cached, &bits, sizeof(cache_type));
+                return traits::from_cache(cached, out);
+            }
+
+            // Разбираем в типе кеша, чтобы значение могли использовать родственные типы
+            if (!ini_value_traits<cache_type>::parse(value, cached))
+            {
+                return false;
+            }
+
+            uint64_t bits = 0;
+            std::memcpy(&bits, &cached, sizeof(cache_type));
+            cache.values[traits::cache_slot].store(bits, std::memory_order_relaxed);
+            cache.valid.fetch_or(bit, std::memory_order_release);
+            return traits::from_cache(cached, out);
+        }
+    }
+
+    // То же с исключением ini_parser_error при неудачном преобразовании
+    template<typename T>
+    T cached_value(const entry_ref& ref) const
+    {
+        T result;
+
+        if (!try_cached_value(ref, result))
+        {
+            throw conversion_error<T>(ref.entry->value);
+        }
+
+        return result;
+    }
+
+    // Метка типа элементов списка в кеше (изменяемая переменная, чтобы
+    // компоновщик не объединял метки разных типов)
+    template<typename T>
+    static inline char list_tag = 0;
 
-    // Шаблонная функция преобразования строки в нужный тип
+    // Тип элементов списка в кеше: строки хранятся представлениями значения
     template<typename T>
-    T convert_value(const std::string& str) const
+    using list_item_t = std::conditional_t<std::is_same_v<T, std::string>, std::string_view, T>;
+
+    // Список, который get_value<std::vector<T>> берет из кеша
+    template<typename T>
+    struct cached_list : std::false_type {};
+
+    template<typename T>
+    struct cached_list<std::vector<T>> : std::bool_constant<std::is_trivially_copyable_v<list_item_t<T>>> {};
+
+    template<typename T>
+    static bool parse_list_item(std::string_view item, void* out)
     {
-        static_assert(sizeof(T) == -1, "Не реализовано преобразование для этого типа");
+        return ini_value_traits<T>::parse(item, *::new (out) T);
+    }
+
+    // Разбор списка в новый узел кеша (под array_store::mutex): nullptr и номер
+    // элемента bad_item, если элемент не преобразуется
+    const array_cache* build_array(const entry_ref& ref, const void* type, size_t item_size,
+        bool (*parse_item)(std::string_view, void*), size_t& bad_item) const;
+
+    // Разобранный список записи с элементами типа T без исключений
+    template<typename T>
+    const array_cache* find_array(const entry_ref& ref, size_t& bad_item) const
+    {
+        static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= array_alignment,
+            "Элементы списка в кеше - числа, bool и std::string_view");
+
+        for (const array_cache* node = ref.cache->arrays.load(std::memory_order_acquire); node != nullptr; node = node->next)
+        {
+            if (node->type == &list_tag<T>)
+            {
+                return node;
+            }
+        }
+
+        return build_array(ref, &list_tag<T>, sizeof(T), &parse_list_item<T>, bad_item);
+    }
+
+    // Список с исключением ini_parser_error, указывающим неверный элемент
+    template<typename T>
+    std::span<const T> cached_array(const entry_ref& ref) const
+    {
+        size_t bad_item = 0;
+        const array_cache* node = find_array<T>(ref, bad_item);
+        count_read(ref, node != nullptr);
+
+        if (node == nullptr)
+        {
+            std::string_view item;
+            ini_for_each_item(ref.entry->value, [&](size_t index, std::string_view text)
+            {
+                item = text;
+                return index != bad_item;
+            });
+
+            throw ini_parser_error("Не удалось преобразовать элемент " + std::to_string(bad_item + 1) + " ('" +
+                std::string(item) + "') списка '" + std::string(ref.entry->value) + "' в " + ini_value_traits<T>::name);
+        }
+
+        return std::span<const T>(static_cast<const T*>(node->items), node->size);
     }
 
+public:
+    // Заранее разрешенный путь к значению - индекс записи в хранилище
+    // (в ленивом режиме - еще и индекс секции). Действителен только для
+    // парсера, которым он получен
+    struct key_handle
+    {
+        uint32_t entry;
+        uint32_t lazy_section = 0;
+    };
+
+    // Ключи одной секции, найденной один раз: записи секции лежат подряд и
+    // упорядочены по ключу, поэтому обход - проход по массиву, а поиск ключа -
+    // двоичный поиск без разбора пути и хеширования. Действителен, пока парсер
+    // существует и не изменяется
+    class section_view
+    {
+    public:
+        // Ключ секции: имя, строка значения и дескриптор для чтения в нужном типе
+        struct item
+        {
+            std::string_view key;
+            std::string_view value;
+            key_handle handle;
+        };
+
+        class iterator
+        {
+        private:
+            const ini_entry* entry = nullptr;
+            key_handle handle = {};
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = item;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = item;
+
+            iterator() = default;
+
+            iterator(const ini_entry* entry, key_handle handle)
+                : entry(entry), handle(handle)
+            {
+            }
+
+            item operator*() const
+            {
+                return { entry->key, entry->value, handle };
+            }
+
+            iterator& operator++()
+            {
+                ++entry;
+                ++handle.entry;
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                iterator prev = *this;
+                ++*this;
+                return prev;
+            }
+
+            bool operator==(const iterator& other) const
+            {
+                return entry == other.entry;
+            }
+        };
+
+        std::string_view name() const
+        {
+            return section_name;
+        }
+
+        size_t size() const
+        {
+            return count;
+        }
+
+        bool empty() const
+        {
+            return count == 0;
+        }
+
+        iterator begin() const
+        {
+            return iterator(first, { first_index, lazy_section });
+        }
+
+        iterator end() const
+        {
+            return iterator(first + count, { first_index + count, lazy_section });
+        }
+
+        // Дескриптор ключа секции или std::nullopt
+        std::optional<key_handle> find(std::string_view key) const
+        {
+            const ini_entry* last = first + count;
+            const ini_entry* it = std::lower_bound(first, last, key,
+                [](const ini_entry& entry, std::string_view name)
+                {
+                    return entry.key < name;
+                });
+
+            if (it == last || it->key != key)
+            {
+                return std::nullopt;
+            }
+
+            return key_handle{ first_index + static_cast<uint32_t>(it - first), lazy_section };
+        }
+
+        // Хеш ключей и значений секции (без имени): у секций с одинаковым
+        // содержимым хеши равны, поэтому сравнение конфигураций пропускает
+        // неизмененную секцию одним сравнением (ini_compare). Вычисляется
+        // при первом обращении за один проход по записям и запоминается в
+        // парсере до изменения секции
+        uint64_t content_hash() const;
+
+        // Значение ключа секции; ошибки и подсказки те же, что у get_value
+        template<typename T>
+        T get(std::string_view key) const
+        {
+            std::optional<key_handle> handle = find(key);
+            return parser->get_value<T>(handle ? *handle : parser->resolve(std::string(section_name) + "." + std::string(key)));
+        }
+
+        template<typename T>
+        std::optional<T> try_get(std::string_view key) const
+        {
+            std::optional<key_handle> handle = find(key);
+            return handle ? parser->try_get_value<T>(*handle) : std::nullopt;
+        }
+
+        // Чтение по дескриптору, найденному через find
+        template<typename T>
+        T get(key_handle handle) const
+        {
+            return parser->get_value<T>(handle);
+        }
+
+        template<typename T>
+        std::optional<T> try_get(key_handle handle) const
+        {
+            return parser->try_get_value<T>(handle);
+        }
+
+    private:
+        friend class ini_parser;
+
+        const ini_parser* parser = nullptr;
+        std::string_view section_name;
+        const ini_entry* first = nullptr;
+        uint32_t first_index = 0;
+        uint32_t count = 0;
+        uint32_t lazy_section = 0;
+        std::atomic<uint64_t>* hash_slot = nullptr;
+    };
+
+private:
+    key_handle make_handle(const entry_ref& ref) const; // Дескриптор найденной записи
+    bool find_section_view(std::string_view name, section_view& view) const; // Поиск секции без исключения для отсутствующей
+    section_view make_section_view(const ini_storage& storage, const ini_section& section,
+        const parsed_section* parsed, uint32_t lazy_section) const; // Представление найденной секции
+
+    // Пустой парсер: память и контейнеры по параметрам, без загрузки
+    explicit ini_parser(const ini_parser_options& options);
+
 public:
     // Конструктор с возможностью создания конфига по умолчанию
     explicit ini_parser(const std::string& filename, bool create_default = false);
 
+    // Конструктор с явными параметрами загрузки
+    ini_parser(const std::string& filename, const ini_parser_options& options);
+
+    // Загрузка в общем пуле потоков (ini_thread_pool::shared) с теми же
+    // параметрами, что у конструктора: чтение и разбор не блокируют вызывающий
+    // поток, ошибки загрузки выбрасывает future::get. Парсер передается через
+    // unique_ptr: перемещенный объект ini_parser еще держит память своего ресурса,
+    // а состояние future может освободить поток пула уже после вызывающего кода.
+    // Для сопрограмм - ini_load_awaitable (ini_async.h)
+    static std::future<std::unique_ptr<ini_parser>> load_async(const std::string& filename, const ini_parser_options& options = {});
+
+    // Разбор текста из памяти: текст копируется в буфер парсера одним блоком,
+    // дальше все как при загрузке файла (parse_threads, lazy, collect_errors,
+    // progress). load_mode, snapshot_file и create_default не учитываются;
+    // сохранять можно только в явно указанный файл
+    static ini_parser from_text(std::string_view text, const ini_parser_options& options = {});
+
+    // Разбор текста, читаемого блоками из reader. При известном размере
+    // (size_hint) блоки читаются подряд в один буфер, и разбор идет как у
+    // from_text. Иначе каждый блок разбирается сразу после чтения и остается
+    // в памяти парсера; копируется только незаконченная строка на границе
+    // блоков. В этом случае parse_threads и lazy не учитываются, а save
+    // записывает секции по порядку без комментариев исходного текста. Текст
+    // не в UTF-8 (по BOM, указанной кодировке или некорректному UTF-8 в первом
+    // блоке при auto_detect) сначала читается целиком, как при известном размере;
+    // некорректный UTF-8 в следующих блоках - ini_parser_error
+    static ini_parser from_chunks(ini_chunk_reader& reader, const ini_parser_options& options = {});
+
+    // Многофайловая конфигурация: файлы разбираются по порядку в одно хранилище,
+    // значение из более позднего файла перекрывает значение из более раннего,
+    // поэтому поиск стоит столько же, сколько для одного файла. Строка
+    // "!include путь" разбирает указанный файл (путь относительно включающего
+    // файла) на месте директивы. Файлы читаются через поток, кодировка каждого
+    // определяется по BOM и содержимому; load_mode, lazy, snapshot_file,
+    // encoding и create_default не учитываются. Файл для save() не задан
+    static ini_parser load_layers(const std::vector<std::string>& layers, const ini_parser_options& options = {});
+
+    // Копия с собственным буфером строк; исходный парсер при этом можно читать
+    // из других потоков. Дескрипторы ключей исходного парсера действительны в копии
+    ini_parser(const ini_parser& other);
+    ini_parser& operator=(const ini_parser&) = delete;
+    ini_parser(ini_parser&&) = default;
+
+    // Перемещающее присваивание запрещено: контейнеры с разными ресурсами
+    // переносились бы поэлементно, а строки хранилища указывают в owned_buffer
+    ini_parser& operator=(ini_parser&&) = delete;
+
     // Шаблонный метод для получения значения
     template<typename T>
-    T get_value(const std::string& key_path)
+    T get_value(std::string_view key_path) const
     {
-        std::string str_value = get_value_as_string(key_path);
-        return convert_value<T>(str_value);
+        return cached_value<T>(find_entry(key_path));
     }
 
-    // Статический метод для создания конфига по умолчанию
-    static void create_default_config(const std::string& filename);
-};
+    // Разрешение пути "Секция.ключ" в дескриптор (ошибки те же, что у get_value).
+    // Сообщение об отсутствующей секции или ключе подсказывает до трех похожих
+    // имен - для частых проверок необязательных ключей служат contains и find
+    key_handle resolve(std::string_view key_path) const;
 
-// Специализация для целых чисел
-template<>
-inline int ini_parser::convert_value<int>(const std::string& str) const
-{
-    try
+    // Получение значения по дескриптору: прямое обращение к записи без поиска
+    template<typename T>
+    T get_value(key_handle handle) const
     {
-        return std::stoi(str);
+        return cached_value<T>(handle_ref(handle.lazy_section, handle.entry));
     }
-    catch (...)
+
+    // Значение-список "a, b, c" (элементы через ',' без пробелов по краям, пустое
+    // значение - пустой список) как непрерывный массив элементов типа T: числа,
+    // bool или std::string_view. Список разбирается при первом обращении для
+    // каждого T и дальше читается из кеша записи без разбора и выделения памяти.
+    // Массив выровнен по 64 байта и дополнен нулями до кратного 64 размера,
+    // поэтому векторный цикл может читать его целыми регистрами. Действителен
+    // до изменения парсера (set_value, remove_key, загрузка). get_value<std::vector<T>> копирует тот же
+    // кешированный список (для std::string - из представлений). Неверный
+    // элемент - ini_parser_error с его номером
+    template<typename T>
+    std::span<const T> get_array(std::string_view key_path) const
     {
-        throw ini_parser_error("Не удалось преобразовать '" + str + "' в int");
+        return cached_array<T>(find_entry(key_path));
     }
-}
 
-// Специализация для чисел double
-template<>
-inline double ini_parser::convert_value<double>(const std::string& str) const
-{
-    try
+    template<typename T>
+    std::span<const T> get_array(key_handle handle) const
     {
-        // Заменяем запятые на точки для корректного парсинга
-        std::string normalized = str;
-        std::replace(normalized.begin(), normalized.end(), ',', '.');
-        return std::stod(normalized);
+        return cached_array<T>(handle_ref(handle.lazy_section, handle.entry));
     }
-    catch (...)
+
+    // То же без исключений: std::nullopt, если ключа нет или элемент не преобразуется
+    template<typename T>
+    std::optional<std::span<const T>> try_get_array(std::string_view key_path) const
     {
-        throw ini_parser_error("Не удалось преобразовать '" + str + "' в double");
+        entry_ref ref;
+        size_t bad_item;
+
+        if (!lookup(key_path, ref))
+        {
+            return std::nullopt;
+        }
+
+        const array_cache* node = find_array<T>(ref, bad_item);
+        count_read(ref, node != nullptr);
+
+        if (node == nullptr)
+        {
+            return std::nullopt;
+        }
+
+        return std::span<const T>(static_cast<const T*>(node->items), node->size);
     }
-}
 
-// Специализация для чисел float
-template<>
-inline float ini_parser::convert_value<float>(const std::string& str) const
-{
-    try
+    // Все ключи секции для обхода или чтения нескольких значений подряд
+    // (ошибки отсутствия секции те же, что у get_value). Заполнение структуры
+    // из секции по списку полей - ini_bind (ini_bind.h)
+    section_view get_section(std::string_view name) const;
+
+    // Поиск секции без исключений: std::nullopt, если секции нет (ошибка
+    // разбора секции в ленивом режиме по-прежнему выбрасывается)
+    std::optional<section_view> find_section(std::string_view name) const;
+
+    // Все секции без поиска по имени: по алфавиту, в ленивом режиме - в порядке
+    // файла (ленивый парсер при этом разбирает все секции, ошибка разбора
+    // выбрасывается). Основа для обхода всей конфигурации и ini_compare
+    std::vector<section_view> sections() const;
+
+    // Проверка наличия ключа без исключений и выделения памяти (false и для
+    // некорректного пути, и для секции ленивого режима с ошибкой разбора)
+    bool contains(std::string_view key_path) const;
+
+    // Поиск ключа без исключений: дескриптор или std::nullopt, если ключ не найден
+    std::optional<key_handle> find(std::string_view key_path) const;
+
+    // Получение значения без исключений: std::nullopt, если ключ не найден
+    // или значение не преобразуется в T
+    template<typename T>
+    std::optional<T> try_get_value(std::string_view key_path) const
     {
-        std::string normalized = str;
-        std::replace(normalized.begin(), normalized.end(), ',', '.');
-        return std::stof(normalized);
+        entry_ref ref;
+        T result;
+
+        if (!lookup(key_path, ref) || !try_cached_value(ref, result))
+        {
+            return std::nullopt;
+        }
+
+        return result;
     }
-    catch (...)
+
+    template<typename T>
+    std::optional<T> try_get_value(key_handle handle) const
     {
-        throw ini_parser_error("Не удалось преобразовать '" + str + "' в float");
+        T result;
+
+        if (!try_cached_value(handle_ref(handle.lazy_section, handle.entry), result))
+        {
+            return std::nullopt;
+        }
+
+        return result;
     }
-}
 
-// Специализация для строк
-template<>
-inline std::string ini_parser::convert_value<std::string>(const std::string& str) const
-{
-    return str;
-}
+    // Файл и строка, откуда взято значение (std::nullopt, если ключ не найден)
+    std::optional<ini_value_origin> origin(std::string_view key_path) const;
 
-// Специализация для булевых значений
-template<>
-inline bool ini_parser::convert_value<bool>(const std::string& str) const
-{
-    std::string lower;
-    lower.reserve(str.size());
+    ini_value_origin origin(key_handle handle) const
+    {
+        return entry_origin(*handle_ref(handle.lazy_section, handle.entry).entry);
+    }
 
-    // Приводим к нижнему регистру для сравнения
-    for (char c : str)
+    // Перевод в неизменяемое состояние для конфигураций, которые после загрузки
+    // только читаются: по всем путям "Секция.ключ" строится совершенная
+    // хеш-функция, и поиск по пути - одна ячейка и одно сравнение пути в плотной
+    // таблице, без пробирования и обращений к записи и секции. Выигрыш заметен
+    // на больших конфигурациях, таблицы которых не помещаются в кеш процессора.
+    // Построение линейно по числу ключей (для миллиона ключей - около 0,2 с),
+    // обычный индекс остается для снимков. Ленивый парсер сначала разбирается
+    // целиком. После freeze set_value и remove_key выбрасывают ini_parser_error,
+    // save по-прежнему доступен; копия замороженного парсера тоже заморожена
+    void freeze();
+
+    bool frozen() const
     {
-        lower.push_back(std::tolower(c));
+        return is_frozen;
     }
 
-    // Поддерживаем разные форматы true
-    if (lower == "true" || lower == "1" || lower == "yes" || lower == "on")
+    // Кодировка, из которой был перекодирован загруженный текст (utf8 - без
+    // перекодирования; для снимка, нескольких файлов и копии - utf8)
+    ini_encoding encoding() const
     {
-        return true;
+        return text_encoding;
     }
 
-    // Поддерживаем разные форматы false
-    if (lower == "false" || lower == "0" || lower == "no" || lower == "off")
+    // Ошибки разбора при загрузке с collect_errors в порядке строк (пусто, если
+    // ошибок не было или парсер загружен из снимка)
+    const std::vector<ini_diagnostic>& diagnostics() const
     {
-        return false;
+        return load_diagnostics;
     }
 
-    throw ini_parser_error("Не удалось преобразовать '" + str + "' в bool");
-}
+    // Снимок статистики: размеры конфигурации и занятая память, а при сборке
+    // с INI_PARSER_STATS - время этапов загрузки и счетчики чтений по ключам.
+    // Счетчики ключа живут вместе с кешем преобразованных значений, поэтому
+    // добавление и удаление ключей их сбрасывает. Передача в систему метрик -
+    // ini_export_stats. Можно вызывать параллельно с чтением значений
+    ini_stats stats() const;
+
+    // Удаление ключа; false, если ключа нет. Как и добавление ключа, сдвигает
+    // записи: полученные ранее дескрипторы становятся недействительными
+    bool remove_key(std::string_view key_path);
+
+    // Запись текущего состояния в файл одной буферизованной записью через временный
+    // файл и переименование. Текст, из которого загружен парсер, сохраняется с
+    // комментариями и порядком строк: меняются значения измененных ключей, строки
+    // удаленных убираются, новые ключи дописываются в конец своей секции, новые
+    // секции - в конец файла. Без исходного текста (снимок, несколько файлов)
+    // записываются все секции по порядку. В режиме incremental, если изменены
+    // только значения, каждое помещается на место прежнего вместе с пробелами
+    // до конца строки, а файл не менялся, переписываются лишь байты этих значений
+    // (остаток заполняется пробелами, которые разбор отбрасывает); иначе - полная
+    // запись. В Windows отображенный файл (ini_load_mode::mapped) заменить нельзя,
+    // там полная запись в него не удается. Ошибка записи - ini_parser_error.
+    // save() без target пишет в загруженный файл; у парсера из load_layers и
+    // from_text такого файла нет (ini_parser_error "Не задан файл для
+    // сохранения"): объединение слоев без комментариев записывается только в
+    // явно указанный target, а не поверх первого слоя
+    void save(ini_save_mode mode = ini_save_mode::full);
+    void save(const std::string& target, ini_save_mode mode = ini_save_mode::full);
+
+    // Установка значения по пути "Секция.ключ"; отсутствующие секция и ключ создаются.
+    // Добавление нового ключа сдвигает записи, поэтому полученные ранее дескрипторы
+    // становятся недействительными и кеш преобразованных значений сбрасывается.
+    // Ленивый парсер перед первым изменением разбирается целиком. Каждый новый
+    // ключ перестраивает массивы и индекс за O(число ключей), поэтому много
+    // новых ключей добавляет set_values
+    void set_value(std::string_view key_path, std::string_view value);
+
+    // Установка набора значений {путь, значение} как серией set_value, но новые
+    // ключи добавляются одним слиянием с одним перестроением индекса и сбросом
+    // кеша: O(N + k log k) на k новых ключей вместо O(N) на каждый. Все пути и
+    // значения проверяются до изменений, поэтому при ошибке парсер не меняется.
+    // Повторный путь в наборе получает последнее значение
+    void set_values(std::span<const std::pair<std::string_view, std::string_view>> values);
+
+    // Статический метод для создания конфига по умолчанию
+    static void create_default_config(const std::string& filename);
+};
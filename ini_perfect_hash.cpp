@@ -0,0 +1,177 @@
+#include "ini_perfect_hash.h"
+#include <algorithm>
+
+// Ключей на корзину в среднем: больше - меньше пилотов, но дольше подбор
+// для последних корзин, когда свободных позиций почти не остается
+static const uint32_t keys_per_bucket = 3;
+
+// Запас позиций при подборе пилотов: 1/table_reserve от числа ключей
+static const uint32_t table_reserve = 20;
+
+ini_perfect_hash::ini_perfect_hash(std::pmr::memory_resource* resource)
+    : pilots(resource), remap(resource)
+{
+}
+
+ini_perfect_hash::ini_perfect_hash(const ini_perfect_hash& other, std::pmr::memory_resource* resource)
+    : pilots(other.pilots, resource), remap(other.remap, resource), key_count(other.key_count), table_size(other.table_size)
+{
+}
+
+void ini_perfect_hash::clear()
+{
+    pilots.clear();
+    remap.clear();
+    key_count = 0;
+    table_size = 0;
+}
+
+// Корзины перебираются от больших к меньшим: крупные размещаются, пока
+// свободных позиций много, а одиночным ключам в конце подходит любая свободная
+bool ini_perfect_hash::build(const std::vector<uint64_t>& hashes)
+{
+    clear();
+
+    if (hashes.empty())
+    {
+        return true;
+    }
+
+    if (hashes.size() >= UINT32_MAX - UINT32_MAX / table_reserve)
+    {
+        return false;
+    }
+
+    uint32_t count = static_cast<uint32_t>(hashes.size());
+    uint32_t size = count + count / table_reserve;
+    pilots.assign(std::max<uint32_t>(1, count / keys_per_bucket), 0);
+    uint32_t bucket_count = static_cast<uint32_t>(pilots.size());
+
+    // Раскладка перемешанных хешей по корзинам подсчетом
+    std::vector<uint32_t> bucket_start(bucket_count + 1, 0);
+
+    for (uint64_t hash : hashes)
+    {
+        bucket_start[bucket(ini_mix_hash(hash)) + 1]++;
+    }
+
+    uint32_t max_size = 0;
+
+    for (uint32_t b = 0; b < bucket_count; ++b)
+    {
+        max_size = std::max(max_size, bucket_start[b + 1]);
+        bucket_start[b + 1] += bucket_start[b];
+    }
+
+    std::vector<uint64_t> keys(count);
+    std::vector<uint32_t> cursor(bucket_start.begin(), bucket_start.end() - 1);
+
+    for (uint64_t hash : hashes)
+    {
+        uint64_t mixed = ini_mix_hash(hash);
+        keys[cursor[bucket(mixed)]++] = mixed;
+    }
+
+    // Порядок корзин по убыванию размера, тоже подсчетом
+    std::vector<uint32_t> size_start(max_size + 2, 0);
+
+    for (uint32_t b = 0; b < bucket_count; ++b)
+    {
+        size_start[max_size - (bucket_start[b + 1] - bucket_start[b]) + 1]++;
+    }
+
+    for (uint32_t i = 0; i <= max_size; ++i)
+    {
+        size_start[i + 1] += size_start[i];
+    }
+
+    std::vector<uint32_t> order(bucket_count);
+
+    for (uint32_t b = 0; b < bucket_count; ++b)
+    {
+        order[size_start[max_size - (bucket_start[b + 1] - bucket_start[b])]++] = b;
+    }
+
+    std::vector<uint8_t> taken(size, 0);
+    std::vector<uint32_t> positions;
+    positions.reserve(max_size);
+
+    for (uint32_t b : order)
+    {
+        uint64_t* first = keys.data() + bucket_start[b];
+        uint64_t* last = keys.data() + bucket_start[b + 1];
+
+        if (first == last)
+        {
+            break;
+        }
+
+        // Одинаковые хеши получают одинаковые позиции при любом пилоте
+        std::sort(first, last);
+
+        if (std::adjacent_find(first, last) != last)
+        {
+            clear();
+            return false;
+        }
+
+        for (uint32_t pilot = 0; ; ++pilot)
+        {
+            if (pilot == UINT32_MAX)
+            {
+                clear();
+                return false;
+            }
+
+            // Позиции отмечаются сразу, чтобы ключи одной корзины не совпали между собой
+            bool placed = true;
+            positions.clear();
+
+            for (const uint64_t* key = first; key != last; ++key)
+            {
+                uint32_t position = place(*key, pilot, size);
+
+                if (taken[position])
+                {
+                    placed = false;
+                    break;
+                }
+
+                taken[position] = 1;
+                positions.push_back(position);
+            }
+
+            if (placed)
+            {
+                pilots[b] = pilot;
+                break;
+            }
+
+            for (uint32_t position : positions)
+            {
+                taken[position] = 0;
+            }
+        }
+    }
+
+    // Занятые позиции запаса переносятся на свободные младше count: их ровно столько же
+    remap.assign(size - count, 0);
+    uint32_t free_position = 0;
+
+    for (uint32_t position = count; position < size; ++position)
+    {
+        if (taken[position])
+        {
+            while (taken[free_position])
+            {
+                ++free_position;
+            }
+
+            remap[position - count] = free_position++;
+        }
+    }
+
+    key_count = count;
+    table_size = size;
+    return true;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
+
+// Перемешивание 64-битного хеша (финализатор splitmix64): биты результата
+// зависят от всех битов аргумента, а разные аргументы дают разные результаты
+inline uint64_t ini_mix_hash(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+// Минимальная совершенная хеш-функция над набором различных 64-битных хешей
+// ключей: каждому из n хешей соответствует своя позиция 0 ... n-1, без проб
+// и пустых ячеек. Хеши раскладываются по корзинам, и для каждой корзины
+// подбирается "пилот" - число, при котором позиции всех ее ключей свободны.
+// Позиция ключа - два перемешивания и два умножения; хеш, которого не было
+// в наборе, получает произвольную позицию, поэтому ключ в ней нужно сверить.
+// Пилоты подбираются для таблицы чуть больше n: так последним корзинам не
+// приходится искать единственные свободные позиции. Позиции за пределами n
+// затем переносятся на оставшиеся свободными позиции младше n
+class ini_perfect_hash
+{
+private:
+    std::pmr::vector<uint32_t> pilots; // Пилот каждой корзины
+    std::pmr::vector<uint32_t> remap;  // Замена позиций table_size - ... n, начиная с n
+    uint32_t key_count = 0;
+    uint32_t table_size = 0;
+
+    // Отображение 32-битного значения в [0, range) умножением вместо деления
+    static uint32_t reduce(uint32_t value, uint32_t range)
+    {
+        return static_cast<uint32_t>((static_cast<uint64_t>(value) * range) >> 32);
+    }
+
+    uint32_t bucket(uint64_t mixed) const
+    {
+        return reduce(static_cast<uint32_t>(mixed), static_cast<uint32_t>(pilots.size()));
+    }
+
+    // Позиция ключа при данном пилоте: перемешанный хеш уже равномерен, поэтому
+    // для новой позиции достаточно одного умножения
+    static uint32_t place(uint64_t mixed, uint32_t pilot, uint32_t count)
+    {
+        uint64_t seeded = (mixed ^ (pilot * 0x9e3779b97f4a7c15ull)) * 0xff51afd7ed558ccdull;
+        return reduce(static_cast<uint32_t>(seeded >> 32), count);
+    }
+
+public:
+    explicit ini_perfect_hash(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    ini_perfect_hash(const ini_perfect_hash& other, std::pmr::memory_resource* resource);
+
+    ini_perfect_hash(const ini_perfect_hash&) = default;
+    ini_perfect_hash(ini_perfect_hash&&) = default;
+    ini_perfect_hash& operator=(const ini_perfect_hash&) = default;
+    ini_perfect_hash& operator=(ini_perfect_hash&&) = default;
+
+    // Построение за линейное в среднем время; false (функция остается пустой),
+    // если хеши повторяются или их больше, чем помещается в 32-битные позиции
+    bool build(const std::vector<uint64_t>& hashes);
+
+    void clear();
+
+    bool empty() const
+    {
+        return key_count == 0;
+    }
+
+    // Позиция хеша из набора, по которому построена функция (функция не пуста)
+    uint32_t position(uint64_t hash) const
+    {
+        uint64_t mixed = ini_mix_hash(hash);
+        uint32_t position = place(mixed, pilots[bucket(mixed)], table_size);
+        return position < key_count ? position : remap[position - key_count];
+    }
+
+    size_t memory_bytes() const
+    {
+        return (pilots.capacity() + remap.capacity()) * sizeof(uint32_t);
+    }
+};
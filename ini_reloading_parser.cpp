@@ -0,0 +1,155 @@
+#include "ini_reloading_parser.h"
+
+ini_reloading_parser::ini_reloading_parser(const std::string& filename, ini_reload_options options)
+    : filename(filename), options(std::move(options)), config(this->filename, this->options.parser)
+{
+    // Файл по умолчанию создается только при первой загрузке
+    this->options.parser.create_default = false;
+
+    if (this->options.watch)
+    {
+        watcher = std::make_unique<ini_file_watcher>(this->filename, this->options.debounce, [this] { reload(); });
+    }
+}
+
+// Разбор идет вне критического пути читателей; публикация - одна атомарная замена
+bool ini_reloading_parser::reload()
+{
+    std::lock_guard<std::mutex> lock(reload_mutex);
+    std::shared_ptr<const ini_parser> previous;
+    std::shared_ptr<const ini_parser> published;
+
+    {
+        std::lock_guard<std::mutex> subscription_lock(subscription_mutex);
+
+        if (options.on_change || !subscriptions.empty())
+        {
+            previous = config.snapshot();
+        }
+    }
+
+    try
+    {
+        published = config.load(filename, options.parser);
+    }
+    catch (const std::exception& error)
+    {
+        if (options.on_error)
+        {
+            options.on_error(error);
+        }
+        return false;
+    }
+
+    if (options.on_reload)
+    {
+        options.on_reload(published);
+    }
+
+    if (previous)
+    {
+        ini_diff diff;
+
+        // Ленивый снимок разбирает секции при сравнении: ошибка разбора не
+        // отменяет публикацию, но сообщается и изменения не рассылаются
+        try
+        {
+            diff = ini_compare(*previous, *published);
+        }
+        catch (const std::exception& error)
+        {
+            if (options.on_error)
+            {
+                options.on_error(error);
+            }
+            return true;
+        }
+
+        if (!diff.empty())
+        {
+            if (options.on_change)
+            {
+                options.on_change(diff);
+            }
+
+            notify(diff);
+        }
+    }
+
+    return true;
+}
+
+// Обработчики копируются под блокировкой и вызываются без нее
+void ini_reloading_parser::notify(const ini_diff& diff)
+{
+    std::vector<std::pair<change_handler, const ini_key_change*>> calls;
+
+    {
+        std::lock_guard<std::mutex> lock(subscription_mutex);
+
+        if (subscriptions.empty())
+        {
+            return;
+        }
+
+        std::string path;
+
+        for (const ini_key_change& change : diff.keys)
+        {
+            path.assign(change.section);
+
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                auto it = subscriptions.find(path);
+
+                if (it != subscriptions.end())
+                {
+                    for (const subscription& item : it->second)
+                    {
+                        calls.emplace_back(item.handler, &change);
+                    }
+                }
+
+                path.append(".").append(change.key);
+            }
+        }
+    }
+
+    for (const auto& [handler, change] : calls)
+    {
+        handler(*change);
+    }
+}
+
+uint64_t ini_reloading_parser::subscribe(std::string path, change_handler handler)
+{
+    std::lock_guard<std::mutex> lock(subscription_mutex);
+    uint64_t id = next_subscription++;
+    subscriptions[std::move(path)].push_back({ id, std::move(handler) });
+    return id;
+}
+
+bool ini_reloading_parser::unsubscribe(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(subscription_mutex);
+
+    for (auto it = subscriptions.begin(); it != subscriptions.end(); ++it)
+    {
+        for (auto item = it->second.begin(); item != it->second.end(); ++item)
+        {
+            if (item->id == id)
+            {
+                it->second.erase(item);
+
+                if (it->second.empty())
+                {
+                    subscriptions.erase(it);
+                }
+
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
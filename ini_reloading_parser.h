@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <exception>
+#include <cstdint>
+#include <mutex>
+#include <map>
+#include <vector>
+#include "ini_concurrent_parser.h"
+#include "ini_diff.h"
+#include "ini_file_watcher.h"
+
+// Параметры перезагрузки. Обработчики вызываются из потока наблюдателя
+// (или из потока, вызвавшего reload()) и не должны выбрасывать исключений.
+// При load_mode == mapped старый снимок продолжает читать отображение файла,
+// поэтому файл нужно заменять переименованием, а не перезаписывать на месте
+struct ini_reload_options
+{
+    ini_parser_options parser;                        // Параметры разбора (create_default действует только при первой загрузке)
+    bool watch = true;                                // Следить за файлом и перечитывать его при изменении
+    std::chrono::milliseconds debounce{ 50 };         // Пауза после последнего изменения перед повторным разбором
+    std::function<void(const std::shared_ptr<const ini_parser>&)> on_reload; // Опубликован новый снимок
+    std::function<void(const std::exception&)> on_error;                    // Повторный разбор не удался, снимок не изменился
+    std::function<void(const ini_diff&)> on_change;   // Новый снимок отличается от прежнего (вызывается после on_reload)
+};
+
+// Конфигурация с горячей перезагрузкой.
+// Каждый разбор дает неизменяемый снимок ini_parser, который публикуется атомарной
+// заменой указателя (ini_concurrent_parser). Читатели никогда не видят частично
+// разобранный файл и не ждут повторного разбора; гарантии чтения те же, что
+// у ini_concurrent_parser. Дескрипторы ключей (resolve) относятся к конкретному
+// снимку и берутся из snapshot().
+// Подписки на ключи и секции (subscribe) получают только изменения своих путей:
+// после публикации новый снимок сравнивается с прежним (ini_compare), и
+// неизмененные секции пропускаются по хешу содержимого. Сравнение выполняется,
+// только если есть подписки или on_change
+class ini_reloading_parser
+{
+public:
+    // Получатель изменения; строки изменения действительны во время вызова
+    using change_handler = std::function<void(const ini_key_change&)>;
+
+private:
+    std::string filename;
+    ini_reload_options options;
+    ini_concurrent_parser config;
+
+    // Перезагрузки идут по одной, поэтому снимок до разбора - тот, с которым
+    // сравнивается новый
+    std::mutex reload_mutex;
+
+    // Подписки по пути "Секция.ключ" или имени секции (вся секция)
+    struct subscription
+    {
+        uint64_t id;
+        change_handler handler;
+    };
+
+    std::mutex subscription_mutex;
+    std::map<std::string, std::vector<subscription>, std::less<>> subscriptions;
+    uint64_t next_subscription = 1;
+
+    void notify(const ini_diff& diff); // Вызов подписчиков измененных путей
+
+    // Наблюдатель объявлен последним: он уничтожается первым и останавливает
+    // поток, вызывающий reload(), пока остальные члены еще живы
+    std::unique_ptr<ini_file_watcher> watcher;
+
+public:
+    // Первая загрузка выполняется сразу и при ошибке выбрасывает исключение
+    explicit ini_reloading_parser(const std::string& filename, ini_reload_options options = {});
+
+    ini_reloading_parser(const ini_reloading_parser&) = delete;
+    ini_reloading_parser& operator=(const ini_reloading_parser&) = delete;
+
+    // Текущий снимок; удерживает его целиком для серии согласованных чтений
+    std::shared_ptr<const ini_parser> snapshot() const
+    {
+        return config.snapshot();
+    }
+
+    // Номер версии текущего снимка (растет при каждой успешной перезагрузке)
+    uint64_t version() const
+    {
+        return config.version();
+    }
+
+    // Повторный разбор файла и публикация снимка. При ошибке прежний снимок
+    // остается в силе, вызывается on_error и возвращается false. Обработчики
+    // вызываются под блокировкой перезагрузки и не должны вызывать reload()
+    bool reload();
+
+    // Подписка на изменения ключа "Секция.ключ" (добавление, удаление, новое
+    // значение) или, если в пути нет '.', всех ключей секции. Обработчик
+    // вызывается из потока перезагрузки без блокировки подписок, поэтому
+    // может подписываться и отписываться. Возвращает номер для unsubscribe
+    uint64_t subscribe(std::string path, change_handler handler);
+
+    // Отмена подписки; false, если ее уже нет
+    bool unsubscribe(uint64_t id);
+
+    // Чтение значения из текущего снимка; std::string_view и другие значения,
+    // указывающие в снимок, читаются через snapshot() (см. ini_concurrent_parser)
+    template<typename T>
+    T get_value(std::string_view key_path) const
+    {
+        return config.get_value<T>(key_path);
+    }
+
+    template<typename T>
+    std::optional<T> try_get_value(std::string_view key_path) const
+    {
+        return config.try_get_value<T>(key_path);
+    }
+};
@@ -0,0 +1,408 @@
+#include "ini_scanner.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define INI_SCANNER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define INI_SCANNER_NEON
+#include <arm_neon.h>
+#endif
+
+// Скалярная разметка: работает везде и служит эталоном для векторных вариантов
+void ini_classify_scalar(const char* block, ini_block_masks& masks)
+{
+    masks = ini_block_masks{};
+
+    for (int i = 0; i < 64; ++i)
+    {
+        char c = block[i];
+        uint64_t bit = 1ull << i;
+
+        if (c == '\n')
+        {
+            masks.newline |= bit;
+        }
+        else if (c == '=')
+        {
+            masks.equals |= bit;
+        }
+        else if (c == ' ' || c == '\t')
+        {
+            masks.blank |= bit;
+            masks.space |= bit;
+        }
+        else if (c == '\v' || c == '\f' || c == '\r')
+        {
+            masks.space |= bit;
+        }
+    }
+}
+
+#ifdef INI_SCANNER_X86
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INI_SCANNER_SSE2
+
+// Разметка четырьмя 16-байтными векторами SSE2
+static void classify_sse2(const char* block, ini_block_masks& masks)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i equals = _mm_set1_epi8('=');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+
+    // Символы '\t'..'\r' сдвигаются в начало знакового диапазона и отбираются одним сравнением
+    const __m128i control_shift = _mm_set1_epi8(static_cast<char>(0x80 - '\t'));
+    const __m128i control_limit = _mm_set1_epi8(static_cast<char>(-128 + 5));
+
+    masks = ini_block_masks{};
+
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+        __m128i is_newline = _mm_cmpeq_epi8(v, newline);
+        __m128i is_blank = _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab));
+        __m128i is_control = _mm_cmplt_epi8(_mm_add_epi8(v, control_shift), control_limit);
+        __m128i is_space = _mm_andnot_si128(is_newline, _mm_or_si128(is_blank, is_control));
+
+        int shift = 16 * i;
+        masks.newline |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(is_newline))) << shift;
+        masks.equals |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, equals)))) << shift;
+        masks.blank |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(is_blank))) << shift;
+        masks.space |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(is_space))) << shift;
+    }
+}
+
+#endif
+
+// Разметка двумя 32-байтными векторами AVX2
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("avx2")))
+#endif
+static void classify_avx2(const char* block, ini_block_masks& masks)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i equals = _mm256_set1_epi8('=');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i control_shift = _mm256_set1_epi8(static_cast<char>(0x80 - '\t'));
+    const __m256i control_limit = _mm256_set1_epi8(static_cast<char>(-128 + 5));
+
+    masks = ini_block_masks{};
+
+    for (int i = 0; i < 2; ++i)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * i));
+        __m256i is_newline = _mm256_cmpeq_epi8(v, newline);
+        __m256i is_blank = _mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab));
+        __m256i is_control = _mm256_cmpgt_epi8(control_limit, _mm256_add_epi8(v, control_shift));
+        __m256i is_space = _mm256_andnot_si256(is_newline, _mm256_or_si256(is_blank, is_control));
+
+        int shift = 32 * i;
+        masks.newline |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(is_newline))) << shift;
+        masks.equals |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, equals)))) << shift;
+        masks.blank |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(is_blank))) << shift;
+        masks.space |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(is_space))) << shift;
+    }
+}
+
+// Поддержка AVX2 процессором и операционной системой
+static bool cpu_has_avx2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    // OSXSAVE и AVX, затем сохранение регистров YMM операционной системой
+    __cpuid(info, 1);
+
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+#ifdef INI_SCANNER_NEON
+
+// Сборка битовой маски из 16 байт-флагов (0x00 или 0xFF)
+static uint64_t neon_movemask(uint8x16_t flags)
+{
+    static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t masked = vandq_u8(flags, vld1q_u8(weights));
+    return static_cast<uint64_t>(vaddv_u8(vget_low_u8(masked))) |
+        (static_cast<uint64_t>(vaddv_u8(vget_high_u8(masked))) << 8);
+}
+
+// Разметка четырьмя 16-байтными векторами NEON
+static void classify_neon(const char* block, ini_block_masks& masks)
+{
+    masks = ini_block_masks{};
+
+    for (int i = 0; i < 4; ++i)
+    {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(block + 16 * i));
+        uint8x16_t is_newline = vceqq_u8(v, vdupq_n_u8('\n'));
+        uint8x16_t is_blank = vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')), vceqq_u8(v, vdupq_n_u8('\t')));
+        uint8x16_t is_control = vcleq_u8(vsubq_u8(v, vdupq_n_u8('\t')), vdupq_n_u8(4));
+        uint8x16_t is_space = vbicq_u8(vorrq_u8(is_blank, is_control), is_newline);
+
+        int shift = 16 * i;
+        masks.newline |= neon_movemask(is_newline) << shift;
+        masks.equals |= neon_movemask(vceqq_u8(v, vdupq_n_u8('='))) << shift;
+        masks.blank |= neon_movemask(is_blank) << shift;
+        masks.space |= neon_movemask(is_space) << shift;
+    }
+}
+
+#endif
+
+// Выбранная реализация разметки и ее название
+struct classifier_choice
+{
+    ini_classify_function function;
+    const char* name;
+};
+
+static classifier_choice detect_classifier()
+{
+#ifdef INI_SCANNER_X86
+    if (cpu_has_avx2())
+    {
+        return { classify_avx2, "avx2" };
+    }
+#endif
+#ifdef INI_SCANNER_SSE2
+    return { classify_sse2, "sse2" };
+#elif defined(INI_SCANNER_NEON)
+    return { classify_neon, "neon" };
+#else
+    return { ini_classify_scalar, "scalar" };
+#endif
+}
+
+// Выбор выполняется один раз за время работы процесса
+static const classifier_choice& selected_classifier()
+{
+    static const classifier_choice choice = detect_classifier();
+    return choice;
+}
+
+ini_classify_function ini_select_classifier()
+{
+    return selected_classifier().function;
+}
+
+const char* ini_classifier_name()
+{
+    return selected_classifier().name;
+}
+
+ini_line_scanner::ini_line_scanner(std::string_view buffer)
+    : buffer(buffer), classify(ini_select_classifier()), window_begin(0), window_end(0), position(0)
+{
+}
+
+// Разметка окна; неполный последний блок дополняется нулями, не попадающими ни в один класс
+void ini_line_scanner::fill_window(size_t begin)
+{
+    window_begin = begin;
+    window_end = std::min(buffer.size(), begin + window_size);
+
+    size_t length = window_end - window_begin;
+    size_t blocks = (length + 63) / 64;
+    ini_block_masks masks;
+
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        const char* block = buffer.data() + window_begin + b * 64;
+        size_t remaining = length - b * 64;
+
+        if (remaining >= 64)
+        {
+            classify(block, masks);
+        }
+        else
+        {
+            char tail[64] = {};
+            std::memcpy(tail, block, remaining);
+            classify(tail, masks);
+        }
+
+        newline[b] = masks.newline;
+        equals[b] = masks.equals;
+        blank[b] = masks.blank;
+        space[b] = masks.space;
+    }
+}
+
+// Поиск первого установленного (или сброшенного) бита в диапазоне окна
+size_t ini_line_scanner::find_bit(const uint64_t* masks, size_t from, size_t to, bool value) const
+{
+    size_t offset = from - window_begin;
+    size_t limit = to - window_begin;
+
+    while (offset < limit)
+    {
+        size_t word = offset >> 6;
+        uint64_t bits = value ? masks[word] : ~masks[word];
+        bits &= ~0ull << (offset & 63);
+
+        if (bits != 0)
+        {
+            size_t found = (word << 6) + static_cast<size_t>(std::countr_zero(bits));
+            return found < limit ? window_begin + found : to;
+        }
+
+        offset = (word + 1) << 6;
+    }
+
+    return to;
+}
+
+// Поиск последнего сброшенного бита в диапазоне окна
+size_t ini_line_scanner::find_last_clear(const uint64_t* masks, size_t from, size_t to) const
+{
+    size_t low = from - window_begin;
+    size_t high = to - window_begin;
+
+    while (high > low)
+    {
+        size_t word = (high - 1) >> 6;
+        size_t top = (high - 1) & 63;
+        uint64_t bits = ~masks[word];
+
+        if (top != 63)
+        {
+            bits &= (2ull << top) - 1;
+        }
+
+        if (bits != 0)
+        {
+            size_t found = (word << 6) + 63 - static_cast<size_t>(std::countl_zero(bits));
+            return found >= low ? window_begin + found + 1 : from;
+        }
+
+        high = word << 6;
+    }
+
+    return from;
+}
+
+// Выделение следующей строки
+bool ini_line_scanner::next(ini_scanned_line& line)
+{
+    if (position >= buffer.size())
+    {
+        return false;
+    }
+
+    if (position < window_begin || position >= window_end)
+    {
+        fill_window(position);
+    }
+
+    size_t line_end = find_bit(newline, position, window_end, true);
+
+    // Строка не закончилась в окне: размечаем окно заново с начала строки
+    if (line_end == window_end && window_end < buffer.size() && position != window_begin)
+    {
+        fill_window(position);
+        line_end = find_bit(newline, position, window_end, true);
+    }
+
+    // Строка длиннее окна целиком
+    if (line_end == window_end && window_end < buffer.size())
+    {
+        line_end = buffer.find('\n', window_end);
+
+        if (line_end == std::string_view::npos)
+        {
+            line_end = buffer.size();
+        }
+    }
+
+    line.begin = position;
+    position = line_end + 1;
+
+    // Окончание строки CRLF: '\r' относится к переводу строки, а не к значению
+    if (line_end > line.begin && buffer[line_end - 1] == '\r')
+    {
+        line_end--;
+    }
+
+    line.end = line_end;
+    line.first = find_not_blank(line.begin, line.end);
+    line.last = find_last_not_blank(line.first, line.end);
+    return true;
+}
+
+size_t ini_line_scanner::find_not_blank(size_t from, size_t to) const
+{
+    if (in_window(from, to))
+    {
+        return find_bit(blank, from, to, false);
+    }
+
+    while (from < to && (buffer[from] == ' ' || buffer[from] == '\t'))
+    {
+        from++;
+    }
+    return from;
+}
+
+size_t ini_line_scanner::find_last_not_blank(size_t from, size_t to) const
+{
+    if (in_window(from, to))
+    {
+        return find_last_clear(blank, from, to);
+    }
+
+    while (to > from && (buffer[to - 1] == ' ' || buffer[to - 1] == '\t'))
+    {
+        to--;
+    }
+    return to;
+}
+
+size_t ini_line_scanner::find_equals(size_t from, size_t to) const
+{
+    if (in_window(from, to))
+    {
+        size_t found = find_bit(equals, from, to, true);
+        return found == to ? std::string_view::npos : found;
+    }
+
+    size_t found = buffer.substr(from, to - from).find('=');
+    return found == std::string_view::npos ? found : from + found;
+}
+
+bool ini_line_scanner::has_space(size_t from, size_t to) const
+{
+    if (in_window(from, to))
+    {
+        return find_bit(space, from, to, true) != to;
+    }
+
+    return ini_has_space(buffer.substr(from, to - from));
+}
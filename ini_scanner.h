@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+// Битовые маски классов символов для блока из 64 байт (бит i - байт i блока)
+struct ini_block_masks
+{
+    uint64_t newline; // '\n'
+    uint64_t equals;  // '='
+    uint64_t blank;   // ' ' и '\t' - символы, удаляемые trim
+    uint64_t space;   // ' ', '\t', '\v', '\f', '\r' - пробельные символы внутри строки
+};
+
+// Разметка блока из 64 байт
+using ini_classify_function = void (*)(const char* block, ini_block_masks& masks);
+
+// Скалярная реализация разметки (эталон для векторных)
+void ini_classify_scalar(const char* block, ini_block_masks& masks);
+
+// Реализация разметки, выбранная по возможностям процессора (AVX2, SSE2, NEON или скалярная)
+ini_classify_function ini_select_classifier();
+
+// Название выбранной реализации для диагностики
+const char* ini_classifier_name();
+
+// Проверка наличия пробельных символов в строке без учета локали
+constexpr bool ini_has_space(std::string_view str)
+{
+    for (char c : str)
+    {
+        if (c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r')
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Строка, выделенная сканером: позиции в буфере
+struct ini_scanned_line
+{
+    size_t begin; // Начало строки
+    size_t end;   // Конец строки без '\n' и завершающего '\r'
+    size_t first; // Первый символ после пробелов в начале (end для пустой строки)
+    size_t last;  // Позиция после последнего символа перед пробелами в конце
+};
+
+// Построчный сканер: буфер размечается окнами по 4 КиБ за один проход,
+// а начала и концы строк, пробелы и '=' находятся по битовым маскам окна.
+// Запросы за пределами окна (строки длиннее окна) выполняются скалярно
+class ini_line_scanner
+{
+private:
+    static constexpr size_t window_blocks = 64;
+    static constexpr size_t window_size = window_blocks * 64;
+
+    std::string_view buffer;
+    ini_classify_function classify;
+
+    // Размеченное окно [window_begin, window_end)
+    size_t window_begin;
+    size_t window_end;
+    uint64_t newline[window_blocks];
+    uint64_t equals[window_blocks];
+    uint64_t blank[window_blocks];
+    uint64_t space[window_blocks];
+
+    // Начало следующей строки
+    size_t position;
+
+    void fill_window(size_t begin); // Разметка окна, начинающегося с begin
+
+    // Первая позиция в [from, to) с установленным (или сброшенным) битом маски окна
+    size_t find_bit(const uint64_t* masks, size_t from, size_t to, bool value) const;
+
+    // Позиция после последнего байта в [from, to) со сброшенным битом маски окна (from, если таких нет)
+    size_t find_last_clear(const uint64_t* masks, size_t from, size_t to) const;
+
+    bool in_window(size_t from, size_t to) const
+    {
+        return from >= window_begin && to <= window_end;
+    }
+
+public:
+    explicit ini_line_scanner(std::string_view buffer);
+
+    // Следующая строка; false, если буфер закончился
+    bool next(ini_scanned_line& line);
+
+    // Первый символ в [from, to), не являющийся ' ' или '\t' (to, если таких нет)
+    size_t find_not_blank(size_t from, size_t to) const;
+
+    // Позиция после последнего символа в [from, to), не являющегося ' ' или '\t' (from, если таких нет)
+    size_t find_last_not_blank(size_t from, size_t to) const;
+
+    // Первый '=' в [from, to) (std::string_view::npos, если не найден)
+    size_t find_equals(size_t from, size_t to) const;
+
+    // Есть ли пробельные символы в [from, to)
+    bool has_space(size_t from, size_t to) const;
+};
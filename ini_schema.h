@@ -0,0 +1,280 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+#include <array>
+#include <utility>
+#include <optional>
+#include <type_traits>
+#include <cstddef>
+#include "ini_error.h"
+#include "ini_parser.h"
+#include "ini_scanner.h"
+
+// Строковый литерал как параметр шаблона: ini_key<"Section1.var1", int>
+template<size_t N>
+struct ini_fixed_string
+{
+    char value[N] = {};
+
+    constexpr ini_fixed_string(const char (&str)[N])
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            value[i] = str[i];
+        }
+    }
+
+    constexpr std::string_view view() const
+    {
+        return std::string_view(value, N - 1);
+    }
+};
+
+template<typename T>
+struct ini_is_fixed_string : std::false_type
+{
+};
+
+template<size_t N>
+struct ini_is_fixed_string<ini_fixed_string<N>> : std::true_type
+{
+};
+
+// Позиция символа в строке при компиляции. string_view::find здесь не подходит:
+// GCC 12 не вычисляет его для строк из параметров шаблона
+constexpr size_t ini_constexpr_find(std::string_view str, char c)
+{
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        if (str[i] == c)
+        {
+            return i;
+        }
+    }
+
+    return std::string_view::npos;
+}
+
+// Проверка пути "Секция.ключ" по тем же правилам, что и при разборе файла:
+// текст ошибки или nullptr. Вычисляется при компиляции для ключей схемы
+constexpr const char* ini_key_path_error(std::string_view path)
+{
+    size_t dot_pos = ini_constexpr_find(path, '.');
+
+    if (dot_pos == std::string_view::npos)
+    {
+        return "Некорректный формат ключа (отсутствует '.')";
+    }
+
+    std::string_view section = path.substr(0, dot_pos);
+    std::string_view key = path.substr(dot_pos + 1);
+
+    if (section.empty() || key.empty())
+    {
+        return "Пустое имя секции или ключа";
+    }
+
+    if (ini_has_space(path) || ini_constexpr_find(path, '\n') != std::string_view::npos)
+    {
+        return "Путь содержит пробелы";
+    }
+
+    // Такие ключи не может дать разбор файла
+    if (ini_constexpr_find(key, '=') != std::string_view::npos || key.front() == ';' || key.front() == '[')
+    {
+        return "Ключ содержит '=' или начинается с ';' или '['";
+    }
+
+    return nullptr;
+}
+
+// Отметка ключа без значения по умолчанию (обязательного)
+struct ini_no_default
+{
+};
+
+// Объявление ключа схемы: путь, тип значения и необязательное значение по
+// умолчанию (для строковых типов - ini_fixed_string("текст")). Путь проверяется
+// при компиляции
+template<ini_fixed_string Path, typename T, auto Default = ini_no_default{}>
+struct ini_key
+{
+    static_assert(ini_key_path_error(Path.view()) == nullptr, "Некорректный путь ключа схемы");
+
+    using value_type = T;
+    static constexpr std::string_view path = Path.view();
+    static constexpr bool required = std::is_same_v<std::remove_cvref_t<decltype(Default)>, ini_no_default>;
+
+    static T default_value()
+    {
+        if constexpr (ini_is_fixed_string<std::remove_cvref_t<decltype(Default)>>::value)
+        {
+            return T(Default.view());
+        }
+        else
+        {
+            return T(Default);
+        }
+    }
+};
+
+// Ошибка привязки схемы: все найденные при загрузке проблемы сразу
+class ini_schema_error : public ini_parser_error
+{
+private:
+    std::vector<std::string> problem_list;
+
+    static std::string join(const std::vector<std::string>& problems)
+    {
+        std::string message = "Конфигурация не соответствует схеме: ";
+
+        for (size_t i = 0; i < problems.size(); ++i)
+        {
+            if (i != 0)
+            {
+                message += "; ";
+            }
+            message += problems[i];
+        }
+
+        return message;
+    }
+
+public:
+    explicit ini_schema_error(std::vector<std::string> problems)
+        : ini_parser_error(join(problems)), problem_list(std::move(problems))
+    {
+    }
+
+    // Отдельные сообщения о каждом отсутствующем или некорректном ключе
+    const std::vector<std::string>& problems() const
+    {
+        return problem_list;
+    }
+};
+
+// Конфигурация, проверенная по схеме. Ключи объявляются типами ini_key,
+// например в структурах по секциям:
+//     struct Section1 { using var1 = ini_key<"Section1.var1", int>; };
+//     ini_schema<Section1::var1, ...> config(parser);
+//     int var1 = config.get<Section1::var1>();
+// Все ключи читаются и преобразуются один раз в конструкторе; get - чтение
+// поля без поиска и разбора. Отсутствующие обязательные ключи и непреобразуемые
+// значения собираются в одно исключение ini_schema_error. Значения типа
+// std::string_view указывают в строки парсера и действительны, пока он жив
+template<typename... Keys>
+class ini_schema
+{
+private:
+    std::tuple<typename Keys::value_type...> values;
+
+    // Пути ключей не повторяются
+    static consteval bool unique_paths()
+    {
+        std::array<std::string_view, sizeof...(Keys)> paths = { Keys::path... };
+
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            for (size_t j = i + 1; j < paths.size(); ++j)
+            {
+                if (paths[i] == paths[j])
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    static_assert(unique_paths(), "Ключ объявлен в схеме дважды");
+
+    // Номер ключа в схеме (sizeof...(Keys), если ключа в ней нет)
+    template<typename Key>
+    static consteval size_t index_of()
+    {
+        std::array<bool, sizeof...(Keys)> matches = { std::is_same_v<Key, Keys>... };
+
+        for (size_t i = 0; i < matches.size(); ++i)
+        {
+            if (matches[i])
+            {
+                return i;
+            }
+        }
+
+        return sizeof...(Keys);
+    }
+
+    // Чтение одного ключа; проблема добавляется в problems
+    template<typename Key>
+    static void bind_key(const ini_parser& parser, typename Key::value_type& out, std::vector<std::string>& problems)
+    {
+        using T = typename Key::value_type;
+        std::optional<ini_parser::key_handle> handle = parser.find(Key::path);
+
+        if (!handle)
+        {
+            if constexpr (!Key::required)
+            {
+                out = Key::default_value();
+            }
+            else
+            {
+                // Сообщение с подсказкой похожих имен дает resolve
+                try
+                {
+                    parser.resolve(Key::path);
+                    problems.push_back("Ключ '" + std::string(Key::path) + "' не найден");
+                }
+                catch (const ini_parser_error& e)
+                {
+                    problems.push_back(e.what());
+                }
+            }
+            return;
+        }
+
+        std::optional<T> value = parser.try_get_value<T>(*handle);
+
+        if (!value)
+        {
+            problems.push_back("Не удалось преобразовать '" + parser.get_value<std::string>(*handle) + "' в " +
+                ini_value_traits<T>::name + " (ключ '" + std::string(Key::path) + "')");
+            return;
+        }
+
+        out = std::move(*value);
+    }
+
+    template<size_t... I>
+    void bind(const ini_parser& parser, std::vector<std::string>& problems, std::index_sequence<I...>)
+    {
+        (bind_key<Keys>(parser, std::get<I>(values), problems), ...);
+    }
+
+public:
+    // Привязка всех ключей схемы к разобранной конфигурации
+    explicit ini_schema(const ini_parser& parser)
+    {
+        std::vector<std::string> problems;
+        bind(parser, problems, std::index_sequence_for<Keys...>());
+
+        if (!problems.empty())
+        {
+            throw ini_schema_error(std::move(problems));
+        }
+    }
+
+    // Значение ключа схемы
+    template<typename Key>
+    const typename Key::value_type& get() const
+    {
+        constexpr size_t index = index_of<Key>();
+        static_assert(index < sizeof...(Keys), "Ключ не объявлен в схеме");
+        return std::get<index>(values);
+    }
+};
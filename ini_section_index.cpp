@@ -0,0 +1,111 @@
+#include "ini_section_index.h"
+#include "ini_events.h"
+#include <algorithm>
+
+ini_section_index::ini_section_index(std::pmr::memory_resource* resource)
+    : sections(resource), ranges(resource)
+{
+}
+
+// Быстрый проход: строки ключей пропускаются по первому символу
+void ini_section_index::build(std::string_view buffer)
+{
+    // Заголовки в порядке файла: имя и участок
+    struct header
+    {
+        std::string_view name;
+        ini_section_range range;
+    };
+
+    std::pmr::vector<header> headers(sections.get_allocator());
+    ini_line_scanner scanner(buffer);
+    ini_scanned_line line;
+    int line_num = 0;
+
+    while (scanner.next(line))
+    {
+        line_num++;
+
+        // Пропускаем пустые строки и комментарии
+        if (line.first == line.last || buffer[line.first] == ';')
+        {
+            continue;
+        }
+
+        if (buffer[line.first] != '[')
+        {
+            // Ключ-значение до первой секции
+            if (headers.empty())
+            {
+                throw ini_parser_error("Ключ-значение вне секции", line_num);
+            }
+            continue;
+        }
+
+        std::string_view name;
+
+        if (const char* error = ini_parse_section_header(scanner, buffer, line, name))
+        {
+            throw ini_parser_error(error, line_num);
+        }
+
+        if (!headers.empty())
+        {
+            headers.back().range.size = line.begin - headers.back().range.offset;
+        }
+
+        headers.push_back({ name, { line.begin, 0, line_num } });
+    }
+
+    if (!headers.empty())
+    {
+        headers.back().range.size = buffer.size() - headers.back().range.offset;
+    }
+
+    // Устойчивая сортировка сохраняет порядок файла среди повторных объявлений
+    std::stable_sort(headers.begin(), headers.end(),
+        [](const header& a, const header& b)
+        {
+            return a.name < b.name;
+        });
+
+    sections.clear();
+    ranges.clear();
+    ranges.reserve(headers.size());
+
+    for (const header& item : headers)
+    {
+        if (sections.empty() || sections.back().name != item.name)
+        {
+            sections.push_back({ item.name, static_cast<uint32_t>(ranges.size()), 0 });
+        }
+
+        sections.back().range_count++;
+        ranges.push_back(item.range);
+    }
+}
+
+void ini_section_index::clear()
+{
+    sections.clear();
+    sections.shrink_to_fit();
+    ranges.clear();
+    ranges.shrink_to_fit();
+}
+
+// Поиск секции двоичным поиском по упорядоченному массиву
+const ini_indexed_section* ini_section_index::find(std::string_view name) const
+{
+    auto it = std::lower_bound(sections.begin(), sections.end(), name,
+        [](const ini_indexed_section& section, std::string_view value)
+        {
+            return section.name < value;
+        });
+
+    if (it == sections.end() || it->name != name)
+    {
+        return nullptr;
+    }
+
+    return &*it;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
+
+// Участок текста одной секции: от строки-заголовка до следующего заголовка
+struct ini_section_range
+{
+    size_t offset;
+    size_t size;
+    int first_line; // Номер строки заголовка в файле
+};
+
+// Секция индекса: имя и ее участки (повторные объявления) в порядке файла
+struct ini_indexed_section
+{
+    std::string_view name;
+    uint32_t first_range;
+    uint32_t range_count;
+};
+
+// Индекс секций для ленивого разбора: быстрый проход по тексту разбирает
+// только заголовки секций и запоминает, где лежит содержимое каждой из них.
+// Строки ключей не проверяются - их ошибки обнаруживаются при разборе секции
+class ini_section_index
+{
+private:
+    std::pmr::vector<ini_indexed_section> sections; // Упорядочены по имени
+    std::pmr::vector<ini_section_range> ranges;     // Сгруппированы по секциям
+
+public:
+    explicit ini_section_index(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Построение индекса по тексту. Ошибки в заголовках секций и строки
+    // до первой секции выбрасывают ini_parser_error, как при полном разборе
+    void build(std::string_view buffer);
+
+    void clear();
+
+    // Память, занятая массивами индекса
+    size_t memory_bytes() const
+    {
+        return sections.capacity() * sizeof(ini_indexed_section) + ranges.capacity() * sizeof(ini_section_range);
+    }
+
+    // Поиск секции по имени (nullptr если секция не найдена)
+    const ini_indexed_section* find(std::string_view name) const;
+
+    const std::pmr::vector<ini_indexed_section>& all_sections() const
+    {
+        return sections;
+    }
+
+    const ini_section_range& range(uint32_t index) const
+    {
+        return ranges[index];
+    }
+};
@@ -0,0 +1,435 @@
+#include "ini_shared_config.h"
+#include "ini_parser.h"
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Управляющий сегмент: номер текущей версии, который читатели загружают
+// атомарно (в общей памяти допустимы только атомарные операции без блокировок)
+struct shared_control
+{
+    char magic[8]; // "INISHM1"
+    std::atomic<uint64_t> version;
+};
+
+// Заголовок сегмента версии; за ним снимок ровно snapshot_size байт
+struct shared_segment_header
+{
+    uint64_t version;
+    uint64_t snapshot_size;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Номер версии в общей памяти требует атомарных операций без блокировок");
+
+static const char shared_magic[8] = "INISHM1";
+
+// Имена сегментов: управляющий - само имя, версии - "имя.версия"
+static std::string system_name(const std::string& name)
+{
+#ifdef _WIN32
+    return "Local\\" + name;
+#else
+    return "/" + name;
+#endif
+}
+
+static std::string segment_name(const std::string& name, uint64_t version)
+{
+    return name + "." + std::to_string(version);
+}
+
+static void validate_shared_name(const std::string& name)
+{
+    if (name.empty() || name.find_first_of("/\\") != std::string::npos)
+    {
+        throw ini_parser_error("Некорректное имя общей памяти: '" + name + "'");
+    }
+}
+
+ini_shared_memory::ini_shared_memory()
+    : region_data(nullptr), region_size(0)
+#ifdef _WIN32
+    , mapping_handle(nullptr)
+#endif
+{
+}
+
+ini_shared_memory::~ini_shared_memory()
+{
+    close();
+}
+
+ini_shared_memory::ini_shared_memory(ini_shared_memory&& other) noexcept
+    : region_data(std::exchange(other.region_data, nullptr)),
+      region_size(std::exchange(other.region_size, 0))
+#ifdef _WIN32
+    , mapping_handle(std::exchange(other.mapping_handle, nullptr))
+#endif
+{
+}
+
+ini_shared_memory& ini_shared_memory::operator=(ini_shared_memory&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        region_data = std::exchange(other.region_data, nullptr);
+        region_size = std::exchange(other.region_size, 0);
+#ifdef _WIN32
+        mapping_handle = std::exchange(other.mapping_handle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool ini_shared_memory::create(const std::string& name, size_t size, bool exclusive)
+{
+    close();
+
+    // Именованное отображение не пересоздается, пока открыто: exclusive
+    // в Windows означает лишь, что содержимое перезаписывает вызывающий
+    (void)exclusive;
+    uint64_t size64 = size;
+    mapping_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), system_name(name).c_str());
+
+    if (mapping_handle == nullptr)
+    {
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping_handle, FILE_MAP_WRITE, 0, 0, size);
+
+    if (view == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    region_data = static_cast<char*>(view);
+    region_size = size;
+    return true;
+}
+
+bool ini_shared_memory::open(const std::string& name)
+{
+    close();
+
+    mapping_handle = OpenFileMappingA(FILE_MAP_READ, FALSE, system_name(name).c_str());
+
+    if (mapping_handle == nullptr)
+    {
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info;
+
+    if (view == nullptr || VirtualQuery(view, &info, sizeof(info)) == 0)
+    {
+        if (view != nullptr)
+        {
+            UnmapViewOfFile(view);
+        }
+        close();
+        return false;
+    }
+
+    // Размер видимой области кратен странице; точный размер данных хранит заголовок
+    region_data = static_cast<char*>(view);
+    region_size = info.RegionSize;
+    return true;
+}
+
+void ini_shared_memory::close()
+{
+    if (region_data != nullptr)
+    {
+        UnmapViewOfFile(region_data);
+        region_data = nullptr;
+    }
+
+    region_size = 0;
+
+    if (mapping_handle != nullptr)
+    {
+        CloseHandle(mapping_handle);
+        mapping_handle = nullptr;
+    }
+}
+
+void ini_shared_memory::remove(const std::string& name)
+{
+    (void)name;
+}
+
+#else
+
+bool ini_shared_memory::create(const std::string& name, size_t size, bool exclusive)
+{
+    close();
+
+    std::string path = system_name(name);
+
+    if (exclusive)
+    {
+        shm_unlink(path.c_str());
+    }
+
+    int descriptor = shm_open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    if (descriptor == -1)
+    {
+        return false;
+    }
+
+    struct stat info;
+    bool sized = fstat(descriptor, &info) == 0 &&
+        (static_cast<size_t>(info.st_size) == size || ftruncate(descriptor, static_cast<off_t>(size)) == 0);
+    void* view = sized ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0) : MAP_FAILED;
+    ::close(descriptor);
+
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+
+    region_data = static_cast<char*>(view);
+    region_size = size;
+    return true;
+}
+
+bool ini_shared_memory::open(const std::string& name)
+{
+    close();
+
+    int descriptor = shm_open(system_name(name).c_str(), O_RDONLY | O_CLOEXEC, 0);
+
+    if (descriptor == -1)
+    {
+        return false;
+    }
+
+    struct stat info;
+    void* view = MAP_FAILED;
+
+    if (fstat(descriptor, &info) == 0 && info.st_size > 0)
+    {
+        view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+    }
+
+    ::close(descriptor);
+
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+
+    region_data = static_cast<char*>(view);
+    region_size = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void ini_shared_memory::close()
+{
+    if (region_data != nullptr)
+    {
+        munmap(region_data, region_size);
+        region_data = nullptr;
+    }
+
+    region_size = 0;
+}
+
+void ini_shared_memory::remove(const std::string& name)
+{
+    shm_unlink(system_name(name).c_str());
+}
+
+#endif
+
+// Управляющий сегмент создается один раз и сохраняет номер версии между
+// запусками публикующего процесса, чтобы номера не повторялись
+ini_shared_publisher::ini_shared_publisher(const std::string& name)
+    : name(name)
+{
+    validate_shared_name(name);
+
+    if (!control.create(name, sizeof(shared_control), false))
+    {
+        throw ini_parser_error("Не удалось создать общую память: " + name);
+    }
+
+    shared_control* header = reinterpret_cast<shared_control*>(control.data());
+
+    if (std::memcmp(header->magic, shared_magic, sizeof(header->magic)) != 0)
+    {
+        new (&header->version) std::atomic<uint64_t>(0);
+        std::memcpy(header->magic, shared_magic, sizeof(header->magic));
+    }
+}
+
+uint64_t ini_shared_publisher::publish(const ini_parser& parser)
+{
+    // Ленивому парсеру нужен полный разбор, а исходный парсер константный
+    std::optional<ini_parser> full;
+
+    if (parser.lazy)
+    {
+        full.emplace(parser);
+        full->materialize();
+    }
+
+    const ini_parser& source = full ? *full : parser;
+    std::string header;
+    std::string payload;
+
+    if (!ini_snapshot::serialize(source.data, ini_snapshot_source{ 0, 0, 0 }, header, payload))
+    {
+        throw ini_parser_error("Конфигурация слишком велика для общей памяти");
+    }
+
+    shared_control* state = reinterpret_cast<shared_control*>(control.data());
+    uint64_t version = state->version.load(std::memory_order_acquire) + 1;
+    std::string next_name = segment_name(name, version);
+    ini_shared_memory next;
+
+    if (!next.create(next_name, sizeof(shared_segment_header) + header.size() + payload.size(), true))
+    {
+        throw ini_parser_error("Не удалось создать общую память: " + next_name);
+    }
+
+    shared_segment_header segment_header = { version, header.size() + payload.size() };
+    std::memcpy(next.data(), &segment_header, sizeof(segment_header));
+    std::memcpy(next.data() + sizeof(segment_header), header.data(), header.size());
+    std::memcpy(next.data() + sizeof(segment_header) + header.size(), payload.data(), payload.size());
+
+    // Сегмент заполнен до публикации номера: читатель, увидевший номер, видит и данные
+    state->version.store(version, std::memory_order_release);
+
+    if (current_version != 0)
+    {
+        ini_shared_memory::remove(segment_name(name, current_version));
+    }
+
+    current = std::move(next);
+    current_version = version;
+    return version;
+}
+
+void ini_shared_publisher::remove(const std::string& name)
+{
+    ini_shared_memory control;
+
+    if (control.open(name) && control.size() >= sizeof(shared_control))
+    {
+        const shared_control* state = reinterpret_cast<const shared_control*>(control.data());
+        ini_shared_memory::remove(segment_name(name, state->version.load(std::memory_order_acquire)));
+    }
+
+    ini_shared_memory::remove(name);
+}
+
+ini_shared_config::ini_shared_config(const std::string& name)
+    : name(name)
+{
+    validate_shared_name(name);
+
+    if (!control.open(name) || control.size() < sizeof(shared_control) ||
+        std::memcmp(control.data(), shared_magic, sizeof(shared_magic)) != 0 || !attach())
+    {
+        throw ini_parser_error("Конфигурация '" + name + "' не опубликована в общей памяти");
+    }
+}
+
+// Публикующий процесс может сменить версию между чтением номера и открытием
+// сегмента (имя прежнего сегмента к этому времени удалено) - тогда номер
+// читается снова
+bool ini_shared_config::attach()
+{
+    const shared_control* state = reinterpret_cast<const shared_control*>(control.data());
+
+    for (int attempt = 0; attempt < 8; ++attempt)
+    {
+        uint64_t version = state->version.load(std::memory_order_acquire);
+        ini_shared_memory next;
+        ini_snapshot_view next_view;
+
+        if (version == 0 || !next.open(segment_name(name, version)) || next.size() < sizeof(shared_segment_header))
+        {
+            continue;
+        }
+
+        shared_segment_header header;
+        std::memcpy(&header, next.data(), sizeof(header));
+
+        if (header.version != version || header.snapshot_size > next.size() - sizeof(header) ||
+            !next_view.open(std::string_view(next.data() + sizeof(header), static_cast<size_t>(header.snapshot_size))))
+        {
+            continue;
+        }
+
+        segment = std::move(next);
+        view = next_view;
+        attached_version = version;
+        return true;
+    }
+
+    return false;
+}
+
+bool ini_shared_config::refresh()
+{
+    const shared_control* state = reinterpret_cast<const shared_control*>(control.data());
+
+    if (state->version.load(std::memory_order_acquire) == attached_version)
+    {
+        return false;
+    }
+
+    uint64_t previous = attached_version;
+    return attach() && attached_version != previous;
+}
+
+bool ini_shared_config::lookup(std::string_view key_path, std::string_view& value) const
+{
+    size_t dot_pos = key_path.find('.');
+
+    if (dot_pos == std::string_view::npos || dot_pos == 0 || dot_pos + 1 == key_path.size())
+    {
+        return false;
+    }
+
+    return view.find(key_path.substr(0, dot_pos), key_path.substr(dot_pos + 1), value);
+}
+
+std::string_view ini_shared_config::find_value(std::string_view key_path) const
+{
+    std::string_view value;
+
+    if (lookup(key_path, value))
+    {
+        return value;
+    }
+
+    if (key_path.find('.') == std::string_view::npos)
+    {
+        throw ini_parser_error("Некорректный формат ключа (отсутствует '.')");
+    }
+
+    throw ini_parser_error("Ключ '" + std::string(key_path) + "' не найден");
+}
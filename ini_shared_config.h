@@ -0,0 +1,157 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+#include "ini_error.h"
+#include "ini_convert.h"
+#include "ini_snapshot.h"
+
+class ini_parser;
+
+// Именованная область общей памяти (shm_open в POSIX, именованное отображение
+// в Windows): создается для записи или открывается только для чтения
+class ini_shared_memory
+{
+private:
+    char* region_data;
+    size_t region_size;
+
+#ifdef _WIN32
+    void* mapping_handle;
+#endif
+
+public:
+    ini_shared_memory();
+    ~ini_shared_memory();
+
+    ini_shared_memory(const ini_shared_memory&) = delete;
+    ini_shared_memory& operator=(const ini_shared_memory&) = delete;
+    ini_shared_memory(ini_shared_memory&& other) noexcept;
+    ini_shared_memory& operator=(ini_shared_memory&& other) noexcept;
+
+    // Создание области размером size для записи (существующая область с тем же
+    // именем сохраняет содержимое, если exclusive == false, иначе пересоздается)
+    bool create(const std::string& name, size_t size, bool exclusive);
+
+    // Открытие существующей области только для чтения
+    bool open(const std::string& name);
+
+    void close();
+
+    // Удаление имени области: отображенные области остаются действительными
+    // до закрытия (в Windows область живет, пока открыт хотя бы один дескриптор)
+    static void remove(const std::string& name);
+
+    char* data() const
+    {
+        return region_data;
+    }
+
+    size_t size() const
+    {
+        return region_size;
+    }
+};
+
+// Публикация разобранной конфигурации в общую память для процессов одного
+// узла. Каждая публикация - новый неизменяемый сегмент "имя.версия" со снимком
+// хранилища (смещения вместо указателей, см. ini_snapshot), а управляющий
+// сегмент "имя" хранит номер текущей версии. После публикации имя предыдущего
+// сегмента удаляется: подключенные к нему читатели работают с ним до refresh.
+// Публикует один процесс; в Windows сегмент существует, пока жив публикующий
+// объект или подключен хотя бы один читатель
+class ini_shared_publisher
+{
+private:
+    std::string name;
+    ini_shared_memory control;
+    ini_shared_memory current;
+    uint64_t current_version = 0;
+
+public:
+    // Имя без '/' и '\'; ошибка создания управляющего сегмента - ini_parser_error
+    explicit ini_shared_publisher(const std::string& name);
+
+    // Публикация снимка конфигурации (ленивый парсер разбирается в копии
+    // целиком); возвращает номер опубликованной версии
+    uint64_t publish(const ini_parser& parser);
+
+    // Удаление имен управляющего и текущего сегментов (в POSIX они иначе
+    // переживают публикующий процесс)
+    static void remove(const std::string& name);
+};
+
+// Конфигурация, опубликованная ini_shared_publisher: сегмент отображается
+// только для чтения, и get_value ищет значение прямо в нем - все процессы
+// делят одну копию данных. Кеша преобразованных значений нет (сегмент
+// неизменяем), поэтому каждое чтение разбирает строку значения. Строки
+// (string_view) указывают в сегмент и действительны до следующего refresh,
+// сменившего версию. Методы чтения можно вызывать из нескольких потоков,
+// refresh требует исключительного доступа
+class ini_shared_config
+{
+private:
+    std::string name;
+    ini_shared_memory control;
+    ini_shared_memory segment;
+    ini_snapshot_view view;
+    uint64_t attached_version = 0;
+
+    bool attach(); // Подключение к текущей версии
+    bool lookup(std::string_view key_path, std::string_view& value) const; // Поиск без исключений
+    std::string_view find_value(std::string_view key_path) const; // Поиск с ini_parser_error
+
+public:
+    // Подключение к текущей версии; ini_parser_error, если конфигурация не опубликована
+    explicit ini_shared_config(const std::string& name);
+
+    // Переход на новую версию, если она опубликована; true, если версия сменилась
+    bool refresh();
+
+    uint64_t version() const
+    {
+        return attached_version;
+    }
+
+    size_t size() const
+    {
+        return view.size();
+    }
+
+    bool contains(std::string_view key_path) const
+    {
+        std::string_view value;
+        return lookup(key_path, value);
+    }
+
+    template<typename T>
+    T get_value(std::string_view key_path) const
+    {
+        std::string_view str = find_value(key_path);
+        T result;
+
+        if (!ini_value_traits<T>::parse(str, result))
+        {
+            throw ini_parser_error("Не удалось преобразовать '" + std::string(str) + "' в " + ini_value_traits<T>::name);
+        }
+
+        return result;
+    }
+
+    template<typename T>
+    std::optional<T> try_get_value(std::string_view key_path) const
+    {
+        std::string_view str;
+        T result;
+
+        if (!lookup(key_path, str) || !ini_value_traits<T>::parse(str, result))
+        {
+            return std::nullopt;
+        }
+
+        return result;
+    }
+};
@@ -0,0 +1,465 @@
+#include "ini_snapshot.h"
+#include "ini_storage.h"
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <thread>
+#include <functional>
+
+// Заголовок снимка; за ним без промежутков идут массивы и таблица строк
+struct snapshot_header
+{
+    char magic[8];          // "INISNAP"
+    uint32_t version;
+    uint32_t byte_order;    // snapshot_byte_order в порядке байт записавшей машины
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;
+    uint64_t checksum;      // ini_checksum всего, что следует за заголовком
+    uint32_t section_count;
+    uint32_t entry_count;
+    uint64_t index_capacity;
+    uint64_t strings_size;
+};
+
+struct snapshot_section
+{
+    uint32_t name_offset;
+    uint32_t name_size;
+    uint32_t first_entry;
+    uint32_t entry_count;
+};
+
+struct snapshot_entry
+{
+    uint32_t key_offset;
+    uint32_t key_size;
+    uint32_t value_offset;
+    uint32_t value_size;
+    uint32_t section;
+    uint32_t line;
+};
+
+// Ячейка хеш-таблицы в снимке - побайтовая копия ini_storage::index_slot
+struct snapshot_slot
+{
+    uint32_t entry;
+    uint32_t tag;
+};
+
+static const char snapshot_magic[8] = "INISNAP";
+static const uint32_t snapshot_byte_order = 0x01020304;
+
+// Хеш с одним умножением на 8 байт: в несколько раз быстрее побайтового FNV-1a
+uint64_t ini_checksum(const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = 14695981039346656037ull ^ size;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+
+    uint64_t tail = 0;
+
+    if (i < size)
+    {
+        std::memcpy(&tail, bytes + i, size - i);
+    }
+
+    hash = (hash ^ tail) * 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 32);
+}
+
+// Добавление объекта в конец буфера
+template<typename T>
+static void append(std::string& out, const T& value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Уникальное имя временного файла рядом с заменяемым
+static std::string temporary_path(const std::string& path)
+{
+    size_t salt = std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+        static_cast<size_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    return path + ".tmp" + std::to_string(salt);
+}
+
+bool ini_replace_file(const std::string& path, std::initializer_list<std::string_view> parts)
+{
+    std::string temporary = temporary_path(path);
+
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+
+        for (std::string_view part : parts)
+        {
+            out.write(part.data(), static_cast<std::streamsize>(part.size()));
+        }
+
+        if (!out.flush())
+        {
+            out.close();
+            std::error_code error;
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+
+    return true;
+}
+
+bool ini_snapshot::serialize(const ini_storage& data, const ini_snapshot_source& source, std::string& header_bytes, std::string& payload)
+{
+    const std::pmr::vector<ini_section>& sections = data.sections;
+    const std::pmr::vector<ini_entry>& entries = data.entries;
+
+    // Таблица строк: имена секций по одному разу, затем ключи и значения
+    std::string strings;
+    payload.clear();
+    payload.reserve(sections.size() * sizeof(snapshot_section) + entries.size() * sizeof(snapshot_entry) +
+        data.index.size() * sizeof(ini_storage::index_slot));
+
+    auto add_string = [&strings](std::string_view str, uint32_t& offset, uint32_t& size)
+    {
+        offset = static_cast<uint32_t>(strings.size());
+        size = static_cast<uint32_t>(str.size());
+        strings.append(str);
+    };
+
+    for (const ini_section& section : sections)
+    {
+        snapshot_section item = {};
+        add_string(section.name, item.name_offset, item.name_size);
+        item.first_entry = section.first_entry;
+        item.entry_count = section.entry_count;
+        append(payload, item);
+    }
+
+    for (const ini_entry& entry : entries)
+    {
+        snapshot_entry item = {};
+        add_string(entry.key, item.key_offset, item.key_size);
+        add_string(entry.value, item.value_offset, item.value_size);
+        item.section = entry.section;
+        item.line = entry.line;
+        append(payload, item);
+    }
+
+    // Смещения строк 32-битные
+    if (strings.size() > UINT32_MAX)
+    {
+        return false;
+    }
+
+    static_assert(sizeof(ini_storage::index_slot) == sizeof(snapshot_slot));
+
+    for (const ini_storage::index_slot& slot : data.index)
+    {
+        append(payload, slot);
+    }
+
+    payload += strings;
+
+    snapshot_header header = {};
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.version = format_version;
+    header.byte_order = snapshot_byte_order;
+    header.source_size = source.size;
+    header.source_mtime = source.mtime;
+    header.source_hash = source.hash;
+    header.checksum = ini_checksum(payload.data(), payload.size());
+    header.section_count = static_cast<uint32_t>(sections.size());
+    header.entry_count = static_cast<uint32_t>(entries.size());
+    header.index_capacity = data.index.size();
+    header.strings_size = strings.size();
+
+    header_bytes.assign(reinterpret_cast<const char*>(&header), sizeof(header));
+    return true;
+}
+
+bool ini_snapshot::write(const std::string& path, const ini_storage& data, const ini_snapshot_source& source)
+{
+    std::string header;
+    std::string payload;
+    return serialize(data, source, header, payload) && ini_replace_file(path, { header, payload });
+}
+
+// Заголовок, если он принадлежит снимку этой версии с тем же порядком байт
+static bool read_header(std::string_view snapshot, snapshot_header& header)
+{
+    if (snapshot.size() < sizeof(snapshot_header))
+    {
+        return false;
+    }
+
+    std::memcpy(&header, snapshot.data(), sizeof(header));
+
+    return std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) == 0 &&
+        header.version == ini_snapshot::format_version &&
+        header.byte_order == snapshot_byte_order;
+}
+
+bool ini_snapshot::read_source(std::string_view snapshot, ini_snapshot_source& source)
+{
+    snapshot_header header;
+
+    if (!read_header(snapshot, header))
+    {
+        return false;
+    }
+
+    source = { header.source_size, header.source_mtime, header.source_hash };
+    return true;
+}
+
+// Расположение частей снимка после проверки заголовка, размеров и контрольной суммы
+struct snapshot_layout
+{
+    snapshot_header header;
+    const char* section_data;
+    const char* entry_data;
+    const char* index_data;
+    std::string_view strings;
+};
+
+static bool read_layout(std::string_view snapshot, snapshot_layout& layout)
+{
+    snapshot_header& header = layout.header;
+
+    if (!read_header(snapshot, header))
+    {
+        return false;
+    }
+
+    // Размер файла должен точно совпадать с суммой частей (без переполнения)
+    const uint64_t payload_size = snapshot.size() - sizeof(snapshot_header);
+    const uint64_t sections_size = uint64_t(header.section_count) * sizeof(snapshot_section);
+    const uint64_t entries_size = uint64_t(header.entry_count) * sizeof(snapshot_entry);
+
+    if (header.index_capacity > payload_size / sizeof(snapshot_slot) ||
+        header.strings_size > payload_size ||
+        sections_size + entries_size + header.index_capacity * sizeof(snapshot_slot) + header.strings_size != payload_size)
+    {
+        return false;
+    }
+
+    // Емкость хеш-таблицы - степень двойки больше числа записей (пустая ячейка завершает поиск)
+    if ((header.index_capacity & (header.index_capacity - 1)) != 0 || header.index_capacity <= header.entry_count)
+    {
+        return false;
+    }
+
+    const char* payload = snapshot.data() + sizeof(snapshot_header);
+
+    if (ini_checksum(payload, static_cast<size_t>(payload_size)) != header.checksum)
+    {
+        return false;
+    }
+
+    layout.section_data = payload;
+    layout.entry_data = layout.section_data + sections_size;
+    layout.index_data = layout.entry_data + entries_size;
+    layout.strings = std::string_view(layout.index_data + header.index_capacity * sizeof(snapshot_slot),
+        static_cast<size_t>(header.strings_size));
+    return true;
+}
+
+// Строка таблицы строк, если она лежит в ее границах
+static bool string_at(std::string_view strings, uint32_t offset, uint32_t size, std::string_view& out)
+{
+    if (offset > strings.size() || size > strings.size() - offset)
+    {
+        return false;
+    }
+
+    out = strings.substr(offset, size);
+    return true;
+}
+
+bool ini_snapshot::read(std::string_view snapshot, ini_storage& data)
+{
+    snapshot_layout layout;
+
+    if (!read_layout(snapshot, layout))
+    {
+        return false;
+    }
+
+    const snapshot_header& header = layout.header;
+    const char* section_data = layout.section_data;
+    const char* entry_data = layout.entry_data;
+    const char* index_data = layout.index_data;
+    std::string_view strings = layout.strings;
+
+    data.sections.clear();
+    data.sections.reserve(header.section_count);
+
+    for (uint32_t i = 0; i < header.section_count; ++i)
+    {
+        snapshot_section item;
+        std::memcpy(&item, section_data + i * sizeof(snapshot_section), sizeof(item));
+        ini_section section = { {}, item.first_entry, item.entry_count };
+
+        if (!string_at(strings, item.name_offset, item.name_size, section.name) ||
+            item.first_entry > header.entry_count || item.entry_count > header.entry_count - item.first_entry)
+        {
+            return false;
+        }
+
+        data.sections.push_back(section);
+    }
+
+    data.entries.clear();
+    data.entries.reserve(header.entry_count);
+
+    for (uint32_t i = 0; i < header.entry_count; ++i)
+    {
+        snapshot_entry item;
+        std::memcpy(&item, entry_data + i * sizeof(snapshot_entry), sizeof(item));
+        ini_entry entry = { {}, {}, item.section, item.line };
+
+        if (!string_at(strings, item.key_offset, item.key_size, entry.key) ||
+            !string_at(strings, item.value_offset, item.value_size, entry.value) ||
+            item.section >= header.section_count)
+        {
+            return false;
+        }
+
+        data.entries.push_back(entry);
+    }
+
+    data.index.resize(static_cast<size_t>(header.index_capacity));
+    std::memcpy(data.index.data(), index_data, data.index.size() * sizeof(ini_storage::index_slot));
+    data.index_mask = header.index_capacity - 1;
+
+    for (const ini_storage::index_slot& slot : data.index)
+    {
+        if (slot.entry > header.entry_count)
+        {
+            return false;
+        }
+    }
+
+    // Таблица имен секций невелика и строится заново, а не хранится в снимке
+    data.build_section_index();
+    return true;
+}
+
+bool ini_snapshot_view::open(std::string_view snapshot)
+{
+    snapshot_layout layout;
+
+    if (!read_layout(snapshot, layout))
+    {
+        return false;
+    }
+
+    const snapshot_header& header = layout.header;
+    std::string_view unused;
+
+    for (uint32_t i = 0; i < header.section_count; ++i)
+    {
+        snapshot_section item;
+        std::memcpy(&item, layout.section_data + i * sizeof(snapshot_section), sizeof(item));
+
+        if (!string_at(layout.strings, item.name_offset, item.name_size, unused))
+        {
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < header.entry_count; ++i)
+    {
+        snapshot_entry item;
+        std::memcpy(&item, layout.entry_data + i * sizeof(snapshot_entry), sizeof(item));
+
+        if (!string_at(layout.strings, item.key_offset, item.key_size, unused) ||
+            !string_at(layout.strings, item.value_offset, item.value_size, unused) ||
+            item.section >= header.section_count)
+        {
+            return false;
+        }
+    }
+
+    for (uint64_t i = 0; i < header.index_capacity; ++i)
+    {
+        snapshot_slot slot;
+        std::memcpy(&slot, layout.index_data + i * sizeof(slot), sizeof(slot));
+
+        if (slot.entry > header.entry_count)
+        {
+            return false;
+        }
+    }
+
+    section_data = layout.section_data;
+    entry_data = layout.entry_data;
+    index_data = layout.index_data;
+    strings = layout.strings;
+    entry_count = header.entry_count;
+    index_mask = header.index_capacity - 1;
+    return true;
+}
+
+// Тот же поиск, что в ini_storage::find, но по записям снимка; их границы
+// проверены в open
+bool ini_snapshot_view::find(std::string_view section, std::string_view key, std::string_view& value) const
+{
+    if (index_data == nullptr)
+    {
+        return false;
+    }
+
+    uint64_t hash = ini_hash(section, key);
+    uint32_t tag = static_cast<uint32_t>(hash >> 32);
+
+    for (size_t slot = static_cast<size_t>(hash & index_mask); ; slot = (slot + 1) & index_mask)
+    {
+        snapshot_slot candidate;
+        std::memcpy(&candidate, index_data + slot * sizeof(candidate), sizeof(candidate));
+
+        if (candidate.entry == 0)
+        {
+            return false;
+        }
+
+        if (candidate.tag != tag)
+        {
+            continue;
+        }
+
+        snapshot_entry entry;
+        std::memcpy(&entry, entry_data + (candidate.entry - 1) * sizeof(snapshot_entry), sizeof(entry));
+
+        if (strings.substr(entry.key_offset, entry.key_size) != key)
+        {
+            continue;
+        }
+
+        snapshot_section owner;
+        std::memcpy(&owner, section_data + entry.section * sizeof(snapshot_section), sizeof(owner));
+
+        if (strings.substr(owner.name_offset, owner.name_size) == section)
+        {
+            value = strings.substr(entry.value_offset, entry.value_size);
+            return true;
+        }
+    }
+}
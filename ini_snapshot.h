@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <initializer_list>
+
+class ini_storage;
+
+// Состояние исходного текстового файла, по которому построен снимок
+struct ini_snapshot_source
+{
+    uint64_t size;  // Размер файла
+    int64_t mtime;  // Время изменения (единицы std::filesystem::file_time_type)
+    uint64_t hash;  // ini_checksum содержимого
+};
+
+// Контрольная сумма блока памяти: перемешивание по 8 байт за шаг
+uint64_t ini_checksum(const void* data, size_t size);
+
+// Замена файла содержимым из частей parts: запись во временный файл рядом
+// и переименование, поэтому читатели не видят недописанный файл. false при ошибке
+bool ini_replace_file(const std::string& path, std::initializer_list<std::string_view> parts);
+
+// Двоичный снимок готового хранилища. Формат: заголовок (версия, порядок байт,
+// отметка исходного файла, контрольная сумма), затем массивы секций, записей
+// и хеш-таблицы и таблица строк. Массивы хранят смещения в таблице строк,
+// поэтому при загрузке строки хранилища указывают прямо в отображенный файл,
+// а хеш-таблица копируется без пересчета хешей. Снимок читается только
+// машиной с тем же порядком байт
+class ini_snapshot
+{
+public:
+    static constexpr uint32_t format_version = 2;
+
+    // Заголовок и остальная часть снимка в памяти; false, если строки не
+    // помещаются в 32-битные смещения
+    static bool serialize(const ini_storage& data, const ini_snapshot_source& source, std::string& header, std::string& payload);
+
+    // Запись через временный файл и переименование: параллельно стартующие
+    // процессы не увидят недописанный снимок. false при ошибке записи
+    static bool write(const std::string& path, const ini_storage& data, const ini_snapshot_source& source);
+
+    // Отметка исходного файла из заголовка (false, если это не снимок этой версии)
+    static bool read_source(std::string_view snapshot, ini_snapshot_source& source);
+
+    // Проверка контрольной суммы и границ и заполнение массивов хранилища;
+    // при ошибке хранилище может остаться заполненным частично
+    static bool read(std::string_view snapshot, ini_storage& data);
+};
+
+// Снимок, из которого значения читаются на месте, без копирования массивов в
+// хранилище: например, снимок в общей памяти нескольких процессов. Границы всех
+// строк и контрольная сумма проверяются один раз в open, поиск идет по той же
+// хеш-таблице, что и в ini_storage. Строки указывают в память снимка
+class ini_snapshot_view
+{
+private:
+    const char* section_data = nullptr;
+    const char* entry_data = nullptr;
+    const char* index_data = nullptr;
+    std::string_view strings;
+    uint32_t entry_count = 0;
+    uint64_t index_mask = 0;
+
+public:
+    // Проверка снимка этой версии; false, если он поврежден
+    bool open(std::string_view snapshot);
+
+    // Значение ключа секции; false, если ключа нет
+    bool find(std::string_view section, std::string_view key, std::string_view& value) const;
+
+    size_t size() const
+    {
+        return entry_count;
+    }
+};
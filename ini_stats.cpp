@@ -0,0 +1,30 @@
+#include "ini_stats.h"
+
+void ini_export_stats(const ini_stats& stats, const ini_metric_sink& sink)
+{
+    sink("ini.sections", {}, stats.sections);
+    sink("ini.keys", {}, stats.keys);
+    sink("ini.memory.storage_bytes", {}, stats.storage_bytes);
+    sink("ini.memory.cache_bytes", {}, stats.cache_bytes);
+    sink("ini.memory.text_bytes", {}, stats.text_bytes);
+
+    // Счетчики без INI_PARSER_STATS не собираются - нули не передаются
+    if (!stats.enabled)
+    {
+        return;
+    }
+
+    sink("ini.parse.read_ns", {}, stats.parse.read_ns);
+    sink("ini.parse.tokenize_ns", {}, stats.parse.tokenize_ns);
+    sink("ini.parse.insert_ns", {}, stats.parse.insert_ns);
+    sink("ini.parse.bytes", {}, stats.parse.bytes);
+    sink("ini.parse.lines", {}, stats.parse.lines);
+    sink("ini.lookup.misses", {}, stats.lookup_misses);
+
+    for (const ini_key_stats& key : stats.hot_keys)
+    {
+        sink("ini.key.reads", key.key, key.reads);
+        sink("ini.key.path_lookups", key.key, key.path_lookups);
+        sink("ini.key.conversion_failures", key.key, key.conversion_failures);
+    }
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+// Встроенная статистика загрузки и чтения значений. Счетчики собираются только
+// при INI_PARSER_STATS=1 (в CMake - параметр INI_ENABLE_STATS): без него классы
+// счетчиков пусты, а их методы ничего не делают, поэтому в разборе и get_value
+// не остается ни замеров времени, ни атомарных операций
+#ifndef INI_PARSER_STATS
+#define INI_PARSER_STATS 0
+#endif
+
+inline constexpr bool ini_stats_enabled = INI_PARSER_STATS != 0;
+
+// Этапы загрузки
+enum class ini_parse_stage
+{
+    read,     // Чтение файла или снимка в память и приведение текста к UTF-8
+    tokenize, // Проход по тексту: разметка строк вместе с проверкой имен
+    insert    // Упорядочивание записей и построение индекса
+};
+
+// Загрузка парсера: время этапов (за все разборы, в том числе секций ленивого
+// режима) и объем разобранного текста
+struct ini_parse_stats
+{
+    uint64_t read_ns = 0;
+    uint64_t tokenize_ns = 0;
+    uint64_t insert_ns = 0;
+    uint64_t bytes = 0;
+    uint64_t lines = 0;
+};
+
+// Чтения одного ключа
+struct ini_key_stats
+{
+    std::string key;              // Путь "Секция.ключ"
+    uint64_t reads;               // Чтения значения (get_value, try_get_value, section_view)
+    uint64_t path_lookups;        // Поиски ключа по пути (в том числе contains, find, resolve)
+    uint64_t conversion_failures; // Чтения, значение которых не преобразовалось в тип
+};
+
+// Снимок статистики парсера (ini_parser::stats)
+struct ini_stats
+{
+    bool enabled = ini_stats_enabled; // Собирались ли счетчики; без них заполнены только размеры
+
+    ini_parse_stats parse;
+
+    size_t sections = 0; // В ленивом режиме - все секции индекса,
+    size_t keys = 0;     // а ключи - только разобранных секций
+
+    // Память данных парсера: массивы хранилищ, кеш преобразованных значений
+    // и собственные копии текста (отображенный файл не учитывается)
+    size_t storage_bytes = 0;
+    size_t cache_bytes = 0;
+    size_t text_bytes = 0;
+
+    uint64_t lookup_misses = 0; // Поиски по пути, не нашедшие ключ
+
+    // Ключи, которые читались или искались, по убыванию числа обращений
+    std::vector<ini_key_stats> hot_keys;
+};
+
+// Приемник метрик: имя метрики, ключ (пусто для метрик всего парсера) и значение
+using ini_metric_sink = std::function<void(std::string_view name, std::string_view key, uint64_t value)>;
+
+// Передача снимка в систему метрик: по вызову sink на каждое значение, имена
+// вида "ini.parse.tokenize_ns", "ini.memory.cache_bytes", "ini.key.reads"
+void ini_export_stats(const ini_stats& stats, const ini_metric_sink& sink);
+
+#if INI_PARSER_STATS
+
+// Счетчики загрузки и промахов поиска парсера. Атомарные: секции ленивого
+// режима разбираются, а ключи ищутся из константных методов в разных потоках
+class ini_parser_counters
+{
+private:
+    std::atomic<uint64_t> stage_ns[3] = {};
+    std::atomic<uint64_t> bytes{ 0 };
+    std::atomic<uint64_t> lines{ 0 };
+    std::atomic<uint64_t> misses{ 0 };
+
+public:
+    ini_parser_counters() = default;
+
+    ini_parser_counters(const ini_parser_counters& other)
+        : bytes(other.bytes.load(std::memory_order_relaxed)),
+          lines(other.lines.load(std::memory_order_relaxed)),
+          misses(other.misses.load(std::memory_order_relaxed))
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            stage_ns[i].store(other.stage_ns[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+
+    void add_time(ini_parse_stage stage, uint64_t ns)
+    {
+        stage_ns[static_cast<int>(stage)].fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    // Текст, поступивший в разбор; последняя строка может не заканчиваться переводом строки
+    void add_text(std::string_view text)
+    {
+        uint64_t count = static_cast<uint64_t>(std::count(text.begin(), text.end(), '\n'));
+        bytes.fetch_add(text.size(), std::memory_order_relaxed);
+        lines.fetch_add(count + (!text.empty() && text.back() != '\n' ? 1 : 0), std::memory_order_relaxed);
+    }
+
+    void count_miss()
+    {
+        misses.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void fill(ini_stats& stats) const
+    {
+        stats.parse.read_ns = stage_ns[static_cast<int>(ini_parse_stage::read)].load(std::memory_order_relaxed);
+        stats.parse.tokenize_ns = stage_ns[static_cast<int>(ini_parse_stage::tokenize)].load(std::memory_order_relaxed);
+        stats.parse.insert_ns = stage_ns[static_cast<int>(ini_parse_stage::insert)].load(std::memory_order_relaxed);
+        stats.parse.bytes = bytes.load(std::memory_order_relaxed);
+        stats.parse.lines = lines.load(std::memory_order_relaxed);
+        stats.lookup_misses = misses.load(std::memory_order_relaxed);
+    }
+};
+
+// Счетчики одной записи; хранятся рядом с ее кешем преобразованных значений
+class ini_key_counters
+{
+private:
+    std::atomic<uint64_t> reads{ 0 };
+    std::atomic<uint64_t> path_lookups{ 0 };
+    std::atomic<uint64_t> failures{ 0 };
+
+public:
+    ini_key_counters() = default;
+
+    ini_key_counters(const ini_key_counters& other)
+        : reads(other.reads.load(std::memory_order_relaxed)),
+          path_lookups(other.path_lookups.load(std::memory_order_relaxed)),
+          failures(other.failures.load(std::memory_order_relaxed))
+    {
+    }
+
+    void count_read(bool converted)
+    {
+        reads.fetch_add(1, std::memory_order_relaxed);
+
+        if (!converted)
+        {
+            failures.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void count_path_lookup()
+    {
+        path_lookups.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool used() const
+    {
+        return reads.load(std::memory_order_relaxed) != 0 || path_lookups.load(std::memory_order_relaxed) != 0;
+    }
+
+    ini_key_stats get(std::string key) const
+    {
+        return { std::move(key), reads.load(std::memory_order_relaxed), path_lookups.load(std::memory_order_relaxed),
+            failures.load(std::memory_order_relaxed) };
+    }
+};
+
+// Замер этапа загрузки от создания объекта до его уничтожения
+class ini_stage_timer
+{
+private:
+    ini_parser_counters& counters;
+    ini_parse_stage stage;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    ini_stage_timer(ini_parser_counters& counters, ini_parse_stage stage)
+        : counters(counters), stage(stage), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ini_stage_timer()
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        counters.add_time(stage, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    ini_stage_timer(const ini_stage_timer&) = delete;
+    ini_stage_timer& operator=(const ini_stage_timer&) = delete;
+};
+
+#else
+
+// Без статистики: пустые классы с тем же интерфейсом
+class ini_parser_counters
+{
+public:
+    void add_text(std::string_view)
+    {
+    }
+
+    void count_miss()
+    {
+    }
+
+    void fill(ini_stats&) const
+    {
+    }
+};
+
+class ini_stage_timer
+{
+public:
+    ini_stage_timer(ini_parser_counters&, ini_parse_stage)
+    {
+    }
+};
+
+#endif
@@ -0,0 +1,551 @@
+#include "ini_storage.h"
+#include "ini_thread_pool.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+ini_storage::ini_storage(std::pmr::memory_resource* resource)
+    : sections(resource), entries(resource), index(resource), section_slots(resource),
+      perfect_hash(resource), frozen_index(resource), frozen_paths(resource), pending_sections(resource), pending_entries(resource)
+{
+}
+
+ini_storage::ini_storage(const ini_storage& other, std::pmr::memory_resource* resource)
+    : sections(other.sections, resource), entries(other.entries, resource), index(other.index, resource),
+      index_mask(other.index_mask), section_slots(other.section_slots, resource), section_mask(other.section_mask),
+      perfect_hash(other.perfect_hash, resource), frozen_index(other.frozen_index, resource), frozen_paths(other.frozen_paths, resource),
+      pending_sections(resource), pending_entries(resource)
+{
+}
+
+// Добавление секции (повторное объявление секции допустимо)
+void ini_storage::add_section(std::string_view name)
+{
+    pending_sections.push_back(name);
+}
+
+// Добавление значения; секция должна быть предварительно добавлена через add_section
+void ini_storage::add_value(std::string_view section, std::string_view key, std::string_view value, uint32_t line)
+{
+    pending_entries.push_back({ section, key, value, line });
+}
+
+// Порядок записей: по секции, затем по ключу
+static bool pending_less(std::string_view a_section, std::string_view a_key, std::string_view b_section, std::string_view b_key)
+{
+    if (a_section != b_section)
+    {
+        return a_section < b_section;
+    }
+    return a_key < b_key;
+}
+
+// Упорядочивание накопленных секций и записей
+void ini_storage::sort_pending()
+{
+    // Секции упорядочены по имени и не повторяются
+    std::sort(pending_sections.begin(), pending_sections.end());
+    pending_sections.erase(std::unique(pending_sections.begin(), pending_sections.end()), pending_sections.end());
+
+    // Устойчивая сортировка сохраняет порядок файла среди повторов одного ключа
+    std::stable_sort(pending_entries.begin(), pending_entries.end(),
+        [](const pending_entry& a, const pending_entry& b)
+        {
+            return pending_less(a.section, a.key, b.section, b.key);
+        });
+
+    pending_sorted = true;
+}
+
+// Упорядочивание накопленных данных в плоские массивы и построение индекса
+void ini_storage::finalize()
+{
+    if (!pending_sorted)
+    {
+        sort_pending();
+    }
+
+    build_arrays(*this);
+    build_index();
+}
+
+// Слияние упорядоченных частей попарно, раунд за раундом; слияния одного раунда идут параллельно
+void ini_storage::finalize(std::vector<ini_storage>& parts, ini_thread_pool& pool)
+{
+    while (parts.size() > 1)
+    {
+        std::vector<ini_storage> merged((parts.size() + 1) / 2);
+
+        pool.parallel_for(merged.size(), [&](size_t i)
+        {
+            ini_storage& target = merged[i];
+
+            if (2 * i + 1 == parts.size())
+            {
+                target = std::move(parts[2 * i]);
+                return;
+            }
+
+            ini_storage& first = parts[2 * i];
+            ini_storage& second = parts[2 * i + 1];
+
+            // std::merge при равенстве берет элемент из первого диапазона, порядок файла сохраняется
+            target.pending_entries.resize(first.pending_entries.size() + second.pending_entries.size());
+            std::merge(first.pending_entries.begin(), first.pending_entries.end(),
+                second.pending_entries.begin(), second.pending_entries.end(),
+                target.pending_entries.begin(),
+                [](const pending_entry& a, const pending_entry& b)
+                {
+                    return pending_less(a.section, a.key, b.section, b.key);
+                });
+
+            target.pending_sections.resize(first.pending_sections.size() + second.pending_sections.size());
+            auto sections_end = std::set_union(first.pending_sections.begin(), first.pending_sections.end(),
+                second.pending_sections.begin(), second.pending_sections.end(),
+                target.pending_sections.begin());
+            target.pending_sections.erase(sections_end, target.pending_sections.end());
+
+            target.pending_sorted = true;
+            first = ini_storage();
+            second = ini_storage();
+        });
+
+        parts = std::move(merged);
+    }
+
+    // Итоговые массивы строятся прямо из результата слияния в ресурсе хранилища
+    if (parts.empty())
+    {
+        finalize();
+        return;
+    }
+
+    if (!parts[0].pending_sorted)
+    {
+        parts[0].sort_pending();
+    }
+
+    build_arrays(parts[0]);
+    parts.clear();
+    build_index();
+}
+
+// Построение массивов секций и записей; из повторов ключа остается последний
+void ini_storage::build_arrays(ini_storage& source)
+{
+    const std::pmr::vector<std::string_view>& source_sections = source.pending_sections;
+    const std::pmr::vector<pending_entry>& source_entries = source.pending_entries;
+
+    sections.clear();
+    sections.reserve(source_sections.size());
+
+    for (std::string_view name : source_sections)
+    {
+        sections.push_back({ name, 0, 0 });
+    }
+
+    entries.clear();
+    entries.reserve(source_entries.size());
+    uint32_t section_index = 0;
+
+    for (size_t i = 0; i < source_entries.size(); ++i)
+    {
+        const pending_entry& entry = source_entries[i];
+
+        // Из повторов ключа остается последнее значение
+        if (i + 1 < source_entries.size() &&
+            source_entries[i + 1].section == entry.section &&
+            source_entries[i + 1].key == entry.key)
+        {
+            continue;
+        }
+
+        // Записи идут в порядке секций, поэтому индекс секции только растет
+        while (sections[section_index].name != entry.section)
+        {
+            section_index++;
+        }
+
+        ini_section& section = sections[section_index];
+
+        if (section.entry_count == 0)
+        {
+            section.first_entry = static_cast<uint32_t>(entries.size());
+        }
+
+        section.entry_count++;
+        entries.push_back({ entry.key, entry.value, section_index, entry.line });
+    }
+
+    // Буферы разбора больше не нужны
+    source.pending_sections.clear();
+    source.pending_sections.shrink_to_fit();
+    source.pending_entries.clear();
+    source.pending_entries.shrink_to_fit();
+    source.pending_sorted = false;
+}
+
+// Построение хеш-таблиц с линейным пробированием, заполненных не более чем наполовину
+void ini_storage::build_index()
+{
+    build_section_index();
+
+    perfect_hash.clear();
+    frozen_index.clear();
+    frozen_paths.clear();
+
+    size_t capacity = 8;
+
+    while (capacity < entries.size() * 2)
+    {
+        capacity *= 2;
+    }
+
+    index.assign(capacity, index_slot{ 0, 0 });
+    index_mask = capacity - 1;
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const ini_entry& entry = entries[i];
+        uint64_t hash = ini_hash(sections[entry.section].name, entry.key);
+        size_t slot = static_cast<size_t>(hash & index_mask);
+
+        while (index[slot].entry != 0)
+        {
+            slot = (slot + 1) & index_mask;
+        }
+
+        index[slot] = { static_cast<uint32_t>(i + 1), static_cast<uint32_t>(hash >> 32) };
+    }
+}
+
+// Обычный индекс остается: по нему пишутся снимки
+bool ini_storage::freeze()
+{
+    std::vector<uint64_t> hashes(entries.size());
+    size_t paths_size = 0;
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        std::string_view section = sections[entries[i].section].name;
+        hashes[i] = ini_hash(section, entries[i].key);
+        paths_size += section.size() + 1 + entries[i].key.size();
+    }
+
+    frozen_index.clear();
+    frozen_paths.clear();
+
+    if (entries.empty() || paths_size > UINT32_MAX || !perfect_hash.build(hashes))
+    {
+        return false;
+    }
+
+    frozen_index.resize(entries.size());
+    frozen_paths.resize(paths_size);
+    uint32_t offset = 0;
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        std::string_view section = sections[entries[i].section].name;
+        std::string_view key = entries[i].key;
+        uint32_t size = static_cast<uint32_t>(section.size() + 1 + key.size());
+
+        std::memcpy(frozen_paths.data() + offset, section.data(), section.size());
+        frozen_paths[offset + section.size()] = '\n';
+        std::memcpy(frozen_paths.data() + offset + section.size() + 1, key.data(), key.size());
+
+        frozen_index[perfect_hash.position(hashes[i])] = { static_cast<uint32_t>(i), static_cast<uint32_t>(hashes[i] >> 32), offset, size };
+        offset += size;
+    }
+
+    return true;
+}
+
+void ini_storage::build_section_index()
+{
+    size_t capacity = 8;
+
+    while (capacity < sections.size() * 2)
+    {
+        capacity *= 2;
+    }
+
+    section_slots.assign(capacity, 0);
+    section_mask = capacity - 1;
+
+    for (size_t i = 0; i < sections.size(); ++i)
+    {
+        size_t slot = static_cast<size_t>(ini_hash(sections[i].name) & section_mask);
+
+        while (section_slots[slot] != 0)
+        {
+            slot = (slot + 1) & section_mask;
+        }
+
+        section_slots[slot] = static_cast<uint32_t>(i + 1);
+    }
+}
+
+// Замена значения записи; индекс не зависит от значения и не перестраивается
+void ini_storage::set_entry_value(uint32_t entry, std::string_view value)
+{
+    entries[entry].value = value;
+    entries[entry].line = 0;
+}
+
+// Номер строки записи после сохранения в файл
+void ini_storage::set_entry_line(uint32_t entry, uint32_t line)
+{
+    entries[entry].line = line;
+}
+
+// Удаление записи со сдвигом диапазонов последующих секций и перестроением индекса
+void ini_storage::erase(uint32_t entry)
+{
+    uint32_t section_index = entries[entry].section;
+    entries.erase(entries.begin() + entry);
+
+    if (--sections[section_index].entry_count == 0)
+    {
+        sections[section_index].first_entry = 0;
+    }
+
+    for (size_t i = section_index + 1; i < sections.size(); ++i)
+    {
+        if (sections[i].entry_count != 0)
+        {
+            sections[i].first_entry--;
+        }
+    }
+
+    build_index();
+}
+
+// Вставка записи с сохранением порядка секций и ключей и перестроением индекса
+uint32_t ini_storage::insert(std::string_view section, std::string_view key, std::string_view value)
+{
+    auto section_it = std::lower_bound(sections.begin(), sections.end(), section,
+        [](const ini_section& item, std::string_view name)
+        {
+            return item.name < name;
+        });
+
+    uint32_t section_index = static_cast<uint32_t>(section_it - sections.begin());
+
+    if (section_it == sections.end() || section_it->name != section)
+    {
+        sections.insert(section_it, { section, 0, 0 });
+
+        for (ini_entry& entry : entries)
+        {
+            if (entry.section >= section_index)
+            {
+                entry.section++;
+            }
+        }
+    }
+
+    // Записи упорядочены по индексу секции, затем по ключу
+    auto entry_it = std::lower_bound(entries.begin(), entries.end(), std::make_pair(section_index, key),
+        [](const ini_entry& entry, const std::pair<uint32_t, std::string_view>& position)
+        {
+            return entry.section != position.first ? entry.section < position.first : entry.key < position.second;
+        });
+
+    uint32_t entry_index = static_cast<uint32_t>(entry_it - entries.begin());
+    entries.insert(entry_it, { key, value, section_index, 0 });
+
+    ini_section& target = sections[section_index];
+
+    if (target.entry_count++ == 0)
+    {
+        target.first_entry = entry_index;
+    }
+
+    for (size_t i = section_index + 1; i < sections.size(); ++i)
+    {
+        if (sections[i].entry_count != 0)
+        {
+            sections[i].first_entry++;
+        }
+    }
+
+    build_index();
+    return entry_index;
+}
+
+// Готовые массивы уже упорядочены так же, как накопленные данные после
+// sort_pending, поэтому достаточно слияния. При равенстве ключей существующая
+// запись идет первой, и build_arrays оставляет накопленную
+void ini_storage::merge_pending()
+{
+    if (pending_entries.empty() && pending_sections.empty())
+    {
+        return;
+    }
+
+    if (!pending_sorted)
+    {
+        sort_pending();
+    }
+
+    ini_storage merged(pending_entries.get_allocator().resource());
+    merged.pending_sections.resize(sections.size() + pending_sections.size());
+    std::vector<std::string_view> existing_sections;
+    existing_sections.reserve(sections.size());
+
+    for (const ini_section& section : sections)
+    {
+        existing_sections.push_back(section.name);
+    }
+
+    auto sections_end = std::set_union(existing_sections.begin(), existing_sections.end(),
+        pending_sections.begin(), pending_sections.end(), merged.pending_sections.begin());
+    merged.pending_sections.erase(sections_end, merged.pending_sections.end());
+
+    merged.pending_entries.reserve(entries.size() + pending_entries.size());
+    auto added = pending_entries.begin();
+
+    for (const ini_entry& entry : entries)
+    {
+        std::string_view section = sections[entry.section].name;
+
+        for (; added != pending_entries.end() && pending_less(added->section, added->key, section, entry.key); ++added)
+        {
+            merged.pending_entries.push_back(*added);
+        }
+
+        merged.pending_entries.push_back({ section, entry.key, entry.value, entry.line });
+    }
+
+    merged.pending_entries.insert(merged.pending_entries.end(), added, pending_entries.end());
+    merged.pending_sorted = true;
+
+    pending_sections.clear();
+    pending_entries.clear();
+    pending_sorted = false;
+
+    build_arrays(merged);
+    build_index();
+}
+
+size_t ini_storage::memory_bytes() const
+{
+    return sections.capacity() * sizeof(ini_section) + entries.capacity() * sizeof(ini_entry) +
+        index.capacity() * sizeof(index_slot) + section_slots.capacity() * sizeof(uint32_t) +
+        perfect_hash.memory_bytes() + frozen_index.capacity() * sizeof(frozen_slot) + frozen_paths.capacity() +
+        pending_sections.capacity() * sizeof(std::string_view) + pending_entries.capacity() * sizeof(pending_entry);
+}
+
+// Суммарный размер имен секций, ключей и значений
+size_t ini_storage::string_bytes() const
+{
+    size_t size = 0;
+
+    for (const ini_section& section : sections)
+    {
+        size += section.name.size();
+    }
+
+    for (const ini_entry& entry : entries)
+    {
+        size += entry.key.size() + entry.value.size();
+    }
+
+    return size;
+}
+
+// Копирование строк подряд в destination и перенаправление на них всех ссылок
+void ini_storage::relocate_strings(char* destination)
+{
+    auto relocate = [&destination](std::string_view& str)
+    {
+        if (str.empty())
+        {
+            return;
+        }
+
+        std::memcpy(destination, str.data(), str.size());
+        str = std::string_view(destination, str.size());
+        destination += str.size();
+    };
+
+    for (ini_section& section : sections)
+    {
+        relocate(section.name);
+    }
+
+    for (ini_entry& entry : entries)
+    {
+        relocate(entry.key);
+        relocate(entry.value);
+    }
+}
+
+// Поиск секции по хешу имени
+const ini_section* ini_storage::find_section(std::string_view name) const
+{
+    if (section_slots.empty())
+    {
+        return nullptr;
+    }
+
+    for (size_t slot = static_cast<size_t>(ini_hash(name) & section_mask); section_slots[slot] != 0; slot = (slot + 1) & section_mask)
+    {
+        const ini_section& section = sections[section_slots[slot] - 1];
+
+        if (section.name == name)
+        {
+            return &section;
+        }
+    }
+
+    return nullptr;
+}
+
+// Поиск записи по хешу полного пути
+const ini_entry* ini_storage::find(std::string_view section, std::string_view key, uint64_t hash) const
+{
+    if (index.empty())
+    {
+        return nullptr;
+    }
+
+    uint32_t tag = static_cast<uint32_t>(hash >> 32);
+
+    // Отсутствующий путь попадает в чужую ячейку и почти всегда отсекается тегом
+    if (!frozen_index.empty())
+    {
+        const frozen_slot& candidate = frozen_index[perfect_hash.position(hash)];
+        const char* path = frozen_paths.data() + candidate.path_offset;
+
+        if (candidate.tag != tag || candidate.path_size != section.size() + 1 + key.size() ||
+            std::memcmp(path, section.data(), section.size()) != 0 || path[section.size()] != '\n' ||
+            std::memcmp(path + section.size() + 1, key.data(), key.size()) != 0)
+        {
+            return nullptr;
+        }
+
+        return &entries[candidate.entry];
+    }
+
+    for (size_t slot = static_cast<size_t>(hash & index_mask); ; slot = (slot + 1) & index_mask)
+    {
+        const index_slot& candidate = index[slot];
+
+        if (candidate.entry == 0)
+        {
+            return nullptr;
+        }
+
+        if (candidate.tag == tag)
+        {
+            const ini_entry& entry = entries[candidate.entry - 1];
+
+            if (entry.key == key && sections[entry.section].name == section)
+            {
+                return &entry;
+            }
+        }
+    }
+}
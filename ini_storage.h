@@ -0,0 +1,194 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
+#include "ini_perfect_hash.h"
+
+class ini_thread_pool;
+
+// Хеш FNV-1a, применяемый к полному пути "Секция.ключ"
+inline uint64_t ini_hash_append(uint64_t hash, std::string_view str)
+{
+    for (char c : str)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint64_t ini_hash(std::string_view str)
+{
+    return ini_hash_append(14695981039346656037ull, str);
+}
+
+// Хеш пути, собранного из секции и ключа, без построения самой строки
+inline uint64_t ini_hash(std::string_view section, std::string_view key)
+{
+    return ini_hash_append(ini_hash_append(ini_hash(section), "."), key);
+}
+
+// Секция: имя и диапазон ее записей в общем массиве
+struct ini_section
+{
+    std::string_view name;
+    uint32_t first_entry;
+    uint32_t entry_count;
+};
+
+// Запись ключ-значение
+struct ini_entry
+{
+    std::string_view key;
+    std::string_view value;
+    uint32_t section; // Индекс секции в массиве секций
+    uint32_t line;    // Номер строки источника (0 - значение задано программно)
+};
+
+// Плоское хранилище конфигурации: все секции и записи лежат в непрерывных массивах.
+// Секции упорядочены по имени, записи сгруппированы по секциям и упорядочены по ключу,
+// поиск по полному пути и по имени секции идет через хеш-таблицы с открытой адресацией
+class ini_storage
+{
+private:
+    friend class ini_snapshot; // Запись и загрузка массивов в двоичном виде
+
+    // Ячейка хеш-таблицы: индекс записи + 1 (0 - пустая ячейка) и старшие биты хеша
+    struct index_slot
+    {
+        uint32_t entry;
+        uint32_t tag;
+    };
+
+    // Запись в порядке появления в файле до вызова finalize()
+    struct pending_entry
+    {
+        std::string_view section;
+        std::string_view key;
+        std::string_view value;
+        uint32_t line;
+    };
+
+    std::pmr::vector<ini_section> sections;
+    std::pmr::vector<ini_entry> entries;
+    std::pmr::vector<index_slot> index;
+    uint64_t index_mask = 0;
+
+    // Хеш-таблица имен секций: индекс секции + 1 (0 - пустая ячейка)
+    std::pmr::vector<uint32_t> section_slots;
+    uint64_t section_mask = 0;
+
+    // Индекс неизменяемой конфигурации (freeze): совершенная хеш-функция дает
+    // позицию ячейки напрямую, а ячейка - тег, запись и путь "секция\nключ" в
+    // общем буфере frozen_paths. Путь сверяется без обращения к записи и секции
+    // ('\n' не встречается в именах, поэтому секция с точкой не спутается с ключом)
+    struct frozen_slot
+    {
+        uint32_t entry;
+        uint32_t tag;
+        uint32_t path_offset;
+        uint32_t path_size;
+    };
+
+    ini_perfect_hash perfect_hash;
+    std::pmr::vector<frozen_slot> frozen_index;
+    std::pmr::vector<char> frozen_paths;
+
+    // Данные, накопленные при разборе
+    std::pmr::vector<std::string_view> pending_sections;
+    std::pmr::vector<pending_entry> pending_entries;
+    bool pending_sorted = false;
+
+    void build_arrays(ini_storage& source); // Построение массивов по упорядоченным накопленным данным source
+    void build_index(); // Построение хеш-таблиц по готовым массивам секций и записей
+    void build_section_index(); // Построение хеш-таблицы имен секций
+
+public:
+    // Все массивы размещаются в resource (память парсера или его арена)
+    explicit ini_storage(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Копия готового хранилища (без накопленных данных) в другом ресурсе;
+    // строки по-прежнему указывают в буфер исходного
+    ini_storage(const ini_storage& other, std::pmr::memory_resource* resource);
+
+    ini_storage(const ini_storage&) = default;
+    ini_storage(ini_storage&&) = default;
+    ini_storage& operator=(const ini_storage&) = default;
+    ini_storage& operator=(ini_storage&&) = default;
+
+    // Наполнение хранилища при разборе (повторный ключ перезаписывает значение).
+    // line - номер строки, сохраняемый в записи для диагностики
+    void add_section(std::string_view name);
+    void add_value(std::string_view section, std::string_view key, std::string_view value, uint32_t line);
+
+    // Упорядочивание накопленных данных (устойчивое: повторы ключа остаются в порядке добавления)
+    void sort_pending();
+
+    // Упорядочивание накопленных данных и построение индекса
+    void finalize();
+
+    // Слияние частей, разобранных параллельно, и построение индекса.
+    // Части идут в порядке файла и уже упорядочены через sort_pending(),
+    // поэтому из повторов ключа побеждает значение из более поздней части.
+    // Части и промежуточные слияния используют ресурс по умолчанию: ресурс
+    // хранилища (например, monotonic_buffer_resource) может быть непотокобезопасным
+    void finalize(std::vector<ini_storage>& parts, ini_thread_pool& pool);
+
+    // Изменение готового хранилища. set_entry_value заменяет значение существующей
+    // записи (номер строки сбрасывается в 0), insert добавляет запись (и при необходимости секцию), которой еще нет,
+    // и возвращает ее индекс, erase удаляет запись (секция остается, даже пустая);
+    // индексы последующих записей при вставке и удалении сдвигаются на единицу
+    void set_entry_value(uint32_t entry, std::string_view value);
+    void set_entry_line(uint32_t entry, uint32_t line);
+    uint32_t insert(std::string_view section, std::string_view key, std::string_view value);
+    void erase(uint32_t entry);
+
+    // Добавление в готовое хранилище записей, накопленных через add_section и
+    // add_value: одна сортировка накопленного, слияние с массивами и одно
+    // построение индекса. Накопленная запись с уже существующим ключом заменяет
+    // его значение, у остальных записей сохраняются номера строк
+    void merge_pending();
+
+    // Индекс совершенного хеширования поверх готового: поиск записи - одна
+    // ячейка и одно сравнение пути. Любое изменение набора записей (insert,
+    // erase, новый разбор) возвращает хранилище к обычному индексу. false,
+    // если хеши двух путей совпали - тогда остается обычный индекс
+    bool freeze();
+
+    bool frozen() const
+    {
+        return !frozen_index.empty();
+    }
+
+    // Перенос всех строк в один непрерывный буфер размером string_bytes()
+    size_t string_bytes() const;
+
+    // Память, занятая массивами и хеш-таблицами (без самих строк)
+    size_t memory_bytes() const;
+    void relocate_strings(char* destination);
+
+    // Поиск секции по имени (nullptr если секция не найдена)
+    const ini_section* find_section(std::string_view name) const;
+
+    // Поиск записи по секции и ключу; hash - ini_hash(section, key)
+    const ini_entry* find(std::string_view section, std::string_view key, uint64_t hash) const;
+
+    const ini_entry* find(std::string_view section, std::string_view key) const
+    {
+        return find(section, key, ini_hash(section, key));
+    }
+
+    // Доступ к массивам для перечисления содержимого
+    const std::pmr::vector<ini_section>& all_sections() const
+    {
+        return sections;
+    }
+
+    const std::pmr::vector<ini_entry>& all_entries() const
+    {
+        return entries;
+    }
+};
@@ -0,0 +1,161 @@
+#include "ini_thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+// Создание рабочих потоков
+ini_thread_pool::ini_thread_pool(unsigned threads)
+    : stopping(false)
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers.reserve(threads);
+
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([this] { worker_loop(); });
+    }
+}
+
+// Остановка пула: уже поставленные задачи выполняются до конца
+ini_thread_pool::~ini_thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        stopping = true;
+    }
+
+    tasks_ready.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// Цикл рабочего потока: ожидание и выполнение задач
+void ini_thread_pool::worker_loop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(tasks_mutex);
+            tasks_ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+            if (tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+// Постановка задачи в очередь
+void ini_thread_pool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        tasks.push_back(std::move(task));
+    }
+
+    tasks_ready.notify_one();
+}
+
+// Параллельное выполнение итераций с участием вызывающего потока
+void ini_thread_pool::parallel_for(size_t count, const std::function<void(size_t)>& fn)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Общее состояние живет, пока его держат опоздавшие задачи-помощники;
+    // к fn они не обращаются, так как все итерации к тому моменту разобраны
+    struct for_state
+    {
+        const std::function<void(size_t)>* fn;
+        size_t count;
+        std::atomic<size_t> next{ 0 };
+        size_t done = 0;
+        std::exception_ptr error;
+        size_t error_index = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    auto state = std::make_shared<for_state>();
+    state->fn = &fn;
+    state->count = count;
+
+    auto run = [state]
+    {
+        for (;;)
+        {
+            size_t i = state->next.fetch_add(1);
+
+            if (i >= state->count)
+            {
+                return;
+            }
+
+            std::exception_ptr error;
+
+            try
+            {
+                (*state->fn)(i);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+
+            if (error && (!state->error || i < state->error_index))
+            {
+                state->error = error;
+                state->error_index = i;
+            }
+
+            if (++state->done == state->count)
+            {
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(count - 1, workers.size());
+
+    for (size_t i = 0; i < helpers; ++i)
+    {
+        submit(run);
+    }
+
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done == state->count; });
+
+    if (state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+}
+
+// Общий пул процесса
+ini_thread_pool& ini_thread_pool::shared()
+{
+    static ini_thread_pool pool;
+    return pool;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Простой пул потоков с общей очередью задач
+class ini_thread_pool
+{
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex tasks_mutex;
+    std::condition_variable tasks_ready;
+    bool stopping;
+
+    void worker_loop(); // Цикл рабочего потока
+
+public:
+    // threads == 0 - по числу аппаратных потоков
+    explicit ini_thread_pool(unsigned threads = 0);
+    ~ini_thread_pool();
+
+    ini_thread_pool(const ini_thread_pool&) = delete;
+    ini_thread_pool& operator=(const ini_thread_pool&) = delete;
+
+    // Количество рабочих потоков
+    unsigned size() const
+    {
+        return static_cast<unsigned>(workers.size());
+    }
+
+    // Постановка задачи в очередь
+    void submit(std::function<void()> task);
+
+    // Выполнение fn(i) для всех i из [0, count) с ожиданием завершения.
+    // Вызывающий поток тоже выполняет итерации, поэтому вызов из задачи пула
+    // не приводит к взаимоблокировке. Если итерации бросили исключения,
+    // повторно бросается исключение итерации с наименьшим номером
+    void parallel_for(size_t count, const std::function<void(size_t)>& fn);
+
+    // Общий пул процесса, создается при первом обращении
+    static ini_thread_pool& shared();
+};